@@ -0,0 +1,917 @@
+/*
+ * lzdgen-codecbench - in-process codec benchmark for lzdatagen
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#if defined(_MSC_VER)
+#  define _CRT_NONSTDC_NO_DEPRECATE
+#  define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(LZDG_HAVE_ZLIB)
+#  include <zlib.h>
+#endif
+#if defined(LZDG_HAVE_ZSTD)
+#  include <zstd.h>
+#endif
+#if defined(LZDG_HAVE_LZ4)
+#  include <lz4frame.h>
+#endif
+
+#include "lzdatagen.h"
+#include "lzdg_cli.h"
+#include "parg.h"
+
+#define EXE_NAME "lzdgen-codecbench"
+
+#define BLOCK_SIZE (1024 * 1024)
+
+/* Maximum number of values in a comma separated list */
+#define MAX_LIST 32
+
+/* Maximum number of codec selections on the command line */
+#define MAX_CODECS 16
+
+/**
+ * Streaming codec interface.
+ *
+ * `comp_update` compresses `src_size` bytes from `src`, writing at most
+ * `dst_cap` bytes to `dst`, and returns the number of bytes written or
+ * `(size_t) -1` on error. If `last` is non-zero, the stream is finished.
+ *
+ * `decomp_update` decompresses all `src_size` bytes from `src`, the next
+ * piece of the stream, in pieces of at most `buf_cap` bytes into `buf`, and
+ * returns the number of bytes produced or `(size_t) -1` on error.
+ */
+struct codec {
+	const char *name;
+	int min_level;
+	int max_level;
+	int default_level;
+	size_t (*bound)(size_t size);
+	void *(*comp_begin)(int level);
+	size_t (*comp_update)(void *ctx, const void *src, size_t src_size, int last, void *dst, size_t dst_cap);
+	void (*comp_end)(void *ctx);
+	void *(*decomp_begin)(void);
+	size_t (*decomp_update)(void *ctx, const void *src, size_t src_size, void *buf, size_t buf_cap);
+	void (*decomp_end)(void *ctx);
+};
+
+struct codec_selection {
+	const struct codec *codec;
+	int levels[MAX_LIST];
+	int num_levels;
+};
+
+#if defined(LZDG_HAVE_ZLIB)
+static size_t
+zlib_bound(size_t size)
+{
+	return compressBound((uLong) size) + 64;
+}
+
+static void *
+zlib_comp_begin(int level)
+{
+	z_stream *strm = (z_stream *) calloc(1, sizeof(z_stream));
+
+	if (strm == NULL) {
+		return NULL;
+	}
+
+	if (deflateInit(strm, level) != Z_OK) {
+		free(strm);
+		return NULL;
+	}
+
+	return strm;
+}
+
+static size_t
+zlib_comp_update(void *ctx, const void *src, size_t src_size, int last, void *dst, size_t dst_cap)
+{
+	z_stream *strm = (z_stream *) ctx;
+	int res;
+
+	strm->next_in = (Bytef *) src;
+	strm->avail_in = (uInt) src_size;
+	strm->next_out = (Bytef *) dst;
+	strm->avail_out = (uInt) (dst_cap > UINT_MAX ? UINT_MAX : dst_cap);
+
+	res = deflate(strm, last ? Z_FINISH : Z_NO_FLUSH);
+
+	if (res == Z_STREAM_ERROR || strm->avail_in != 0 || (last && res != Z_STREAM_END)) {
+		return (size_t) -1;
+	}
+
+	return (size_t) (strm->next_out - (Bytef *) dst);
+}
+
+static void
+zlib_comp_end(void *ctx)
+{
+	z_stream *strm = (z_stream *) ctx;
+
+	deflateEnd(strm);
+	free(strm);
+}
+
+static void *
+zlib_decomp_begin(void)
+{
+	z_stream *strm = (z_stream *) calloc(1, sizeof(z_stream));
+
+	if (strm == NULL) {
+		return NULL;
+	}
+
+	if (inflateInit(strm) != Z_OK) {
+		free(strm);
+		return NULL;
+	}
+
+	return strm;
+}
+
+static size_t
+zlib_decomp_update(void *ctx, const void *src, size_t src_size, void *buf, size_t buf_cap)
+{
+	z_stream *strm = (z_stream *) ctx;
+	size_t total = 0;
+	int res;
+
+	strm->next_in = (Bytef *) src;
+	strm->avail_in = (uInt) src_size;
+
+	do {
+		strm->next_out = (Bytef *) buf;
+		strm->avail_out = (uInt) buf_cap;
+
+		res = inflate(strm, Z_NO_FLUSH);
+
+		if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) {
+			return (size_t) -1;
+		}
+
+		total += buf_cap - strm->avail_out;
+	} while (res == Z_OK && (strm->avail_in != 0 || strm->avail_out == 0));
+
+	if (strm->avail_in != 0) {
+		return (size_t) -1;
+	}
+
+	return total;
+}
+
+static void
+zlib_decomp_end(void *ctx)
+{
+	z_stream *strm = (z_stream *) ctx;
+
+	inflateEnd(strm);
+	free(strm);
+}
+
+static const struct codec codec_zlib = {
+	"zlib", 1, 9, 6,
+	zlib_bound, zlib_comp_begin, zlib_comp_update, zlib_comp_end,
+	zlib_decomp_begin, zlib_decomp_update, zlib_decomp_end
+};
+#endif /* LZDG_HAVE_ZLIB */
+
+#if defined(LZDG_HAVE_ZSTD)
+static size_t
+zstd_bound(size_t size)
+{
+	return ZSTD_compressBound(size) + ZSTD_CStreamOutSize();
+}
+
+static void *
+zstd_comp_begin(int level)
+{
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+
+	if (cctx == NULL) {
+		return NULL;
+	}
+
+	if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level))) {
+		ZSTD_freeCCtx(cctx);
+		return NULL;
+	}
+
+	return cctx;
+}
+
+static size_t
+zstd_comp_update(void *ctx, const void *src, size_t src_size, int last, void *dst, size_t dst_cap)
+{
+	ZSTD_inBuffer in = { src, src_size, 0 };
+	ZSTD_outBuffer out = { dst, dst_cap, 0 };
+	ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+	size_t res;
+
+	do {
+		res = ZSTD_compressStream2((ZSTD_CCtx *) ctx, &out, &in, mode);
+
+		if (ZSTD_isError(res) || (res != 0 && out.pos == out.size)) {
+			return (size_t) -1;
+		}
+	} while (last ? res != 0 : in.pos != in.size);
+
+	return out.pos;
+}
+
+static void
+zstd_comp_end(void *ctx)
+{
+	ZSTD_freeCCtx((ZSTD_CCtx *) ctx);
+}
+
+static void *
+zstd_decomp_begin(void)
+{
+	return ZSTD_createDCtx();
+}
+
+static size_t
+zstd_decomp_update(void *ctx, const void *src, size_t src_size, void *buf, size_t buf_cap)
+{
+	ZSTD_inBuffer in = { src, src_size, 0 };
+	size_t total = 0;
+	size_t res;
+
+	for (;;) {
+		ZSTD_outBuffer out = { buf, buf_cap, 0 };
+
+		res = ZSTD_decompressStream((ZSTD_DCtx *) ctx, &out, &in);
+
+		if (ZSTD_isError(res)) {
+			return (size_t) -1;
+		}
+
+		total += out.pos;
+
+		if (in.pos == in.size && out.pos < out.size) {
+			break;
+		}
+	}
+
+	return total;
+}
+
+static void
+zstd_decomp_end(void *ctx)
+{
+	ZSTD_freeDCtx((ZSTD_DCtx *) ctx);
+}
+
+static const struct codec codec_zstd = {
+	"zstd", 1, 22, 3,
+	zstd_bound, zstd_comp_begin, zstd_comp_update, zstd_comp_end,
+	zstd_decomp_begin, zstd_decomp_update, zstd_decomp_end
+};
+#endif /* LZDG_HAVE_ZSTD */
+
+#if defined(LZDG_HAVE_LZ4)
+struct lz4_ctx {
+	LZ4F_cctx *cctx;
+	LZ4F_preferences_t prefs;
+	int started;
+};
+
+static size_t
+lz4_bound(size_t size)
+{
+	return LZ4F_compressFrameBound(size, NULL) + LZ4F_HEADER_SIZE_MAX;
+}
+
+static void *
+lz4_comp_begin(int level)
+{
+	struct lz4_ctx *ctx = (struct lz4_ctx *) calloc(1, sizeof(struct lz4_ctx));
+
+	if (ctx == NULL) {
+		return NULL;
+	}
+
+	if (LZ4F_isError(LZ4F_createCompressionContext(&ctx->cctx, LZ4F_VERSION))) {
+		free(ctx);
+		return NULL;
+	}
+
+	ctx->prefs.compressionLevel = level;
+
+	return ctx;
+}
+
+static size_t
+lz4_comp_update(void *ctx, const void *src, size_t src_size, int last, void *dst, size_t dst_cap)
+{
+	struct lz4_ctx *lctx = (struct lz4_ctx *) ctx;
+	unsigned char *d = (unsigned char *) dst;
+	size_t pos = 0;
+	size_t res;
+
+	if (!lctx->started) {
+		res = LZ4F_compressBegin(lctx->cctx, d, dst_cap, &lctx->prefs);
+
+		if (LZ4F_isError(res)) {
+			return (size_t) -1;
+		}
+
+		pos += res;
+		lctx->started = 1;
+	}
+
+	res = LZ4F_compressUpdate(lctx->cctx, d + pos, dst_cap - pos, src, src_size, NULL);
+
+	if (LZ4F_isError(res)) {
+		return (size_t) -1;
+	}
+
+	pos += res;
+
+	if (last) {
+		res = LZ4F_compressEnd(lctx->cctx, d + pos, dst_cap - pos, NULL);
+
+		if (LZ4F_isError(res)) {
+			return (size_t) -1;
+		}
+
+		pos += res;
+	}
+
+	return pos;
+}
+
+static void
+lz4_comp_end(void *ctx)
+{
+	struct lz4_ctx *lctx = (struct lz4_ctx *) ctx;
+
+	LZ4F_freeCompressionContext(lctx->cctx);
+	free(lctx);
+}
+
+static void *
+lz4_decomp_begin(void)
+{
+	LZ4F_dctx *dctx = NULL;
+
+	if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) {
+		return NULL;
+	}
+
+	return dctx;
+}
+
+static size_t
+lz4_decomp_update(void *ctx, const void *src, size_t src_size, void *buf, size_t buf_cap)
+{
+	const unsigned char *s = (const unsigned char *) src;
+	size_t total = 0;
+
+	for (;;) {
+		size_t in_size = src_size;
+		size_t out_size = buf_cap;
+		size_t res;
+
+		res = LZ4F_decompress((LZ4F_dctx *) ctx, buf, &out_size, s, &in_size, NULL);
+
+		if (LZ4F_isError(res) || (src_size > 0 && in_size == 0 && out_size == 0)) {
+			return (size_t) -1;
+		}
+
+		s += in_size;
+		src_size -= in_size;
+		total += out_size;
+
+		if (src_size == 0 && out_size < buf_cap) {
+			break;
+		}
+	}
+
+	return total;
+}
+
+static void
+lz4_decomp_end(void *ctx)
+{
+	LZ4F_freeDecompressionContext((LZ4F_dctx *) ctx);
+}
+
+static const struct codec codec_lz4 = {
+	"lz4", 0, 12, 0,
+	lz4_bound, lz4_comp_begin, lz4_comp_update, lz4_comp_end,
+	lz4_decomp_begin, lz4_decomp_update, lz4_decomp_end
+};
+#endif /* LZDG_HAVE_LZ4 */
+
+static const struct codec *const codecs[] = {
+#if defined(LZDG_HAVE_ZLIB)
+	&codec_zlib,
+#endif
+#if defined(LZDG_HAVE_ZSTD)
+	&codec_zstd,
+#endif
+#if defined(LZDG_HAVE_LZ4)
+	&codec_lz4,
+#endif
+	NULL
+};
+
+/* Return monotonic time in seconds */
+static double
+get_time(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER freq;
+	LARGE_INTEGER count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+
+	return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/* Parse CODEC[:LEVEL,...] into `sel`, returns 0 on success */
+static int
+parse_codec(const char *s, struct codec_selection *sel)
+{
+	const char *colon = strchr(s, ':');
+	size_t name_len = colon ? (size_t) (colon - s) : strlen(s);
+	int i;
+
+	sel->codec = NULL;
+	sel->num_levels = 0;
+
+	for (i = 0; codecs[i] != NULL; ++i) {
+		if (strlen(codecs[i]->name) == name_len
+		 && strncmp(codecs[i]->name, s, name_len) == 0) {
+			sel->codec = codecs[i];
+			break;
+		}
+	}
+
+	if (sel->codec == NULL) {
+		return -1;
+	}
+
+	if (colon == NULL) {
+		sel->levels[sel->num_levels++] = sel->codec->default_level;
+		return 0;
+	}
+
+	s = colon + 1;
+
+	for (;;) {
+		char *ep = NULL;
+		long v;
+
+		if (sel->num_levels == MAX_LIST) {
+			return -1;
+		}
+
+		errno = 0;
+
+		v = strtol(s, &ep, 10);
+
+		if (ep == s || errno == ERANGE || (*ep != ',' && *ep != '\0')
+		 || v < sel->codec->min_level || v > sel->codec->max_level) {
+			return -1;
+		}
+
+		sel->levels[sel->num_levels++] = (int) v;
+
+		if (*ep == '\0') {
+			break;
+		}
+
+		s = ep + 1;
+	}
+
+	return 0;
+}
+
+static void
+printf_error(const char *fmt, ...)
+{
+	va_list arg;
+
+	fprintf(stderr, EXE_NAME ": ");
+
+	va_start(arg, fmt);
+	vfprintf(stderr, fmt, arg);
+	va_end(arg);
+
+	fprintf(
+	    stderr,
+	    "\n"
+	    "usage: " EXE_NAME " [-bhV] [-c CODEC[:LEVELS]] [-l EXPS] [-m EXPS]\n"
+	    "                         [-r RATIOS] [-S SEED] [-s SIZE]\n");
+}
+
+static void
+print_help(void)
+{
+	int i;
+
+	printf(
+	    "usage: " EXE_NAME " [options]\n"
+	    "\n"
+	    "Benchmark codecs on generated data without temporary files.\n"
+	    "\n"
+	    "options:\n"
+	    "  -b, --bulk               use faster, less precise method\n"
+	    "  -c, --codec CODEC[:LVL]  codec and comma separated levels [all]\n"
+	    "  -h, --help               print this help and exit\n"
+	    "  -l, --literal-exp EXPS   literal distribution exponents [3.0]\n"
+	    "  -m, --match-exp EXPS     match length distribution exponents [3.0]\n"
+	    "  -r, --ratio RATIOS       compression ratio targets [3.0]\n"
+	    "  -S, --seed SEED          use 64-bit SEED to seed PRNG\n"
+	    "  -s, --size SIZE          size with opt. k/m/g suffix [16m]\n"
+	    "  -V, --version            print version and exit\n"
+	    "\n"
+	    "EXPS and RATIOS are comma separated lists, every combination is run.\n"
+	    "\n"
+	    "available codecs:");
+
+	for (i = 0; codecs[i] != NULL; ++i) {
+		printf(" %s", codecs[i]->name);
+	}
+
+	printf("%s\n", i == 0 ? " none" : "");
+}
+
+static void
+print_version(void)
+{
+	printf(
+	    EXE_NAME " " LZDG_VER_STRING "\n"
+	    "\n"
+	    "Copyright 2016-2023 Joergen Ibsen\n"
+	    "\n"
+	    "Licensed under the Apache License, Version 2.0.\n"
+	    "There is NO WARRANTY, to the extent permitted by law.\n");
+}
+
+/**
+ * Generate `size` bytes and run them through `codec` at `level`.
+ *
+ * Data is generated, compressed and decompressed one block at a time, with
+ * the compressed output of each block passed to the decompressor before the
+ * next is generated, so memory use does not depend on `size`.
+ *
+ * @return 0 on success
+ */
+static int
+run_bench(const struct codec *codec, int level, uint64_t seed, size_t size,
+          double ratio, double len_exp, double lit_exp, int flag_bulk,
+          unsigned char *block, unsigned char *comp, size_t comp_cap)
+{
+	double t_gen = 0.0;
+	double t_comp = 0.0;
+	double t_decomp = 0.0;
+	double t;
+	size_t comp_size = 0;
+	size_t decomp_size = 0;
+	size_t offs = 0;
+	void *ctx;
+	void *dctx;
+	int retval = 1;
+
+	ctx = codec->comp_begin(level);
+	dctx = codec->decomp_begin();
+
+	if (ctx == NULL || dctx == NULL) {
+		fprintf(stderr, EXE_NAME ": unable to initialize %s\n", codec->name);
+		goto out;
+	}
+
+	lzdg_seed(seed);
+
+	while (offs < size) {
+		size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+		size_t res;
+
+		t = get_time();
+
+		if (flag_bulk) {
+			lzdg_generate_data_bulk(block, num, ratio, len_exp, lit_exp);
+		}
+		else {
+			lzdg_generate_data(block, num, ratio, len_exp, lit_exp);
+		}
+
+		offs += num;
+
+		t_gen += get_time() - t;
+
+		t = get_time();
+
+		res = codec->comp_update(ctx, block, num, offs == size, comp, comp_cap);
+
+		t_comp += get_time() - t;
+
+		if (res == (size_t) -1) {
+			fprintf(stderr, EXE_NAME ": %s compression error\n", codec->name);
+			goto out;
+		}
+
+		comp_size += res;
+
+		/* The codec has consumed the block, so it can hold the output */
+		t = get_time();
+
+		res = codec->decomp_update(dctx, comp, res, block, BLOCK_SIZE);
+
+		t_decomp += get_time() - t;
+
+		if (res == (size_t) -1) {
+			fprintf(stderr, EXE_NAME ": %s decompression error\n", codec->name);
+			goto out;
+		}
+
+		decomp_size += res;
+	}
+
+	if (decomp_size != size) {
+		fprintf(stderr, EXE_NAME ": %s decompression error\n", codec->name);
+		goto out;
+	}
+
+	printf("%-6s %5d %6.2f %6.2f %6.2f %12zu %12zu %7.3f %10.1f %10.1f %10.1f\n",
+	       codec->name, level, ratio, lit_exp, len_exp, size, comp_size,
+	       (double) size / (comp_size ? comp_size : 1),
+	       size / (t_gen > 0.0 ? t_gen : 1e-9) / 1e6,
+	       size / (t_comp > 0.0 ? t_comp : 1e-9) / 1e6,
+	       size / (t_decomp > 0.0 ? t_decomp : 1e-9) / 1e6);
+
+	fflush(stdout);
+
+	retval = 0;
+
+out:
+	if (dctx != NULL) {
+		codec->decomp_end(dctx);
+	}
+
+	if (ctx != NULL) {
+		codec->comp_end(ctx);
+	}
+
+	return retval;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct parg_state ps;
+	struct codec_selection sel[MAX_CODECS];
+	double ratios[MAX_LIST] = { 3.0 };
+	double len_exps[MAX_LIST] = { 3.0 };
+	double lit_exps[MAX_LIST] = { 3.0 };
+	unsigned char *block = NULL;
+	unsigned char *comp = NULL;
+	uint64_t seed;
+	size_t size = 16 * 1024 * 1024;
+	size_t comp_cap = 0;
+	int num_sel = 0;
+	int num_ratios = 1;
+	int num_len_exps = 1;
+	int num_lit_exps = 1;
+	int flag_bulk = 0;
+	int retval = EXIT_FAILURE;
+	int i, j, k, l, n;
+	int c;
+
+	const struct parg_option long_options[] = {
+		{ "bulk", PARG_NOARG, NULL, 'b' },
+		{ "codec", PARG_REQARG, NULL, 'c' },
+		{ "help", PARG_NOARG, NULL, 'h' },
+		{ "literal-exp", PARG_REQARG, NULL, 'l' },
+		{ "match-exp", PARG_REQARG, NULL, 'm' },
+		{ "ratio", PARG_REQARG, NULL, 'r' },
+		{ "seed", PARG_REQARG, NULL, 'S' },
+		{ "size", PARG_REQARG, NULL, 's' },
+		{ "version", PARG_NOARG, NULL, 'V' },
+		{ 0, 0, 0, 0 }
+	};
+
+	seed = time(NULL) ^ (intptr_t) &printf;
+
+	parg_init(&ps);
+
+	while ((c = parg_getopt_long(&ps, argc, argv, "bc:hl:m:r:S:s:V", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'b':
+			flag_bulk = 1;
+			break;
+		case 'c':
+			if (num_sel == MAX_CODECS) {
+				printf_error("too many codecs");
+				return EXIT_FAILURE;
+			}
+
+			if (parse_codec(ps.optarg, &sel[num_sel]) != 0) {
+				printf_error("unknown codec or invalid level in `%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+
+			num_sel++;
+			break;
+		case 'l':
+			num_lit_exps = lzdg_parse_list(ps.optarg, lit_exps, MAX_LIST);
+
+			for (i = 0; i < num_lit_exps; ++i) {
+				if (!lzdg_valid_exp(lit_exps[i])) {
+					num_lit_exps = -1;
+				}
+			}
+
+			if (num_lit_exps < 0) {
+				printf_error("literal exponents must be positive floating point values");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'm':
+			num_len_exps = lzdg_parse_list(ps.optarg, len_exps, MAX_LIST);
+
+			for (i = 0; i < num_len_exps; ++i) {
+				if (!lzdg_valid_exp(len_exps[i])) {
+					num_len_exps = -1;
+				}
+			}
+
+			if (num_len_exps < 0) {
+				printf_error("match exponents must be positive floating point values");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			num_ratios = lzdg_parse_list(ps.optarg, ratios, MAX_LIST);
+
+			for (i = 0; i < num_ratios; ++i) {
+				if (!lzdg_valid_ratio(ratios[i])) {
+					num_ratios = -1;
+				}
+			}
+
+			if (num_ratios < 0) {
+				printf_error("ratios must be finite floating point values >= 1.0");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'S':
+			{
+				char *ep = NULL;
+				uint64_t v;
+
+				errno = 0;
+
+				v = strtoull(ps.optarg, &ep, 0);
+
+				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE) {
+					printf_error("seed value error");
+					return EXIT_FAILURE;
+				}
+
+				seed = v;
+			}
+			break;
+		case 's':
+			{
+				char *ep = NULL;
+				size_t v;
+
+				errno = 0;
+
+				v = lzdg_strtosize(ps.optarg, &ep, 0);
+
+				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE || v == 0) {
+					printf_error("size must be a positive integer");
+					return EXIT_FAILURE;
+				}
+
+				size = v;
+			}
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+			break;
+		case 'V':
+			print_version();
+			return EXIT_SUCCESS;
+			break;
+		default:
+			printf_error("option error at `%s'", argv[ps.optind - 1]);
+			return EXIT_FAILURE;
+			break;
+		}
+	}
+
+	if (num_sel == 0) {
+		for (i = 0; codecs[i] != NULL; ++i) {
+			sel[num_sel].codec = codecs[i];
+			sel[num_sel].levels[0] = codecs[i]->default_level;
+			sel[num_sel].num_levels = 1;
+			num_sel++;
+		}
+
+		if (num_sel == 0) {
+			fprintf(stderr, EXE_NAME ": no codecs available in this build\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	/*
+	 * Output of one update, which may include up to a block of input the
+	 * codec buffered from earlier updates
+	 */
+	for (i = 0; i < num_sel; ++i) {
+		size_t cap = sel[i].codec->bound(2 * BLOCK_SIZE);
+
+		if (cap > comp_cap) {
+			comp_cap = cap;
+		}
+	}
+
+	block = (unsigned char *) malloc(BLOCK_SIZE);
+	comp = (unsigned char *) malloc(comp_cap);
+
+	if (block == NULL || comp == NULL) {
+		perror(EXE_NAME ": unable to allocate buffers");
+		goto out;
+	}
+
+	fprintf(stderr, EXE_NAME ": seed 0x%016" PRIX64 " (%s)\n", seed, lzdg_rng_name());
+
+	printf("%-6s %5s %6s %6s %6s %12s %12s %7s %10s %10s %10s\n",
+	       "codec", "level", "target", "litexp", "lenexp", "size",
+	       "compressed", "ratio", "gen MB/s", "comp MB/s", "dec MB/s");
+
+	for (i = 0; i < num_ratios; ++i) {
+		for (j = 0; j < num_lit_exps; ++j) {
+			for (k = 0; k < num_len_exps; ++k) {
+				for (l = 0; l < num_sel; ++l) {
+					for (n = 0; n < sel[l].num_levels; ++n) {
+						if (run_bench(sel[l].codec, sel[l].levels[n], seed, size,
+						              ratios[i], len_exps[k], lit_exps[j], flag_bulk,
+						              block, comp, comp_cap) != 0) {
+							goto out;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	retval = EXIT_SUCCESS;
+
+out:
+	free(comp);
+	free(block);
+
+	return retval;
+}
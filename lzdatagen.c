@@ -18,39 +18,249 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
 #include "lzdatagen.h"
+#include "lzdg_internal.h"
 
-#include <assert.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
-#include "pcg_basic.h"
+#if defined(__linux__)
+#  include <sys/mman.h>
+/* Request 2 MiB pages explicitly, the default huge page size may differ */
+#  if !defined(MAP_HUGE_2MB) && defined(MAP_HUGE_SHIFT)
+#    define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#  endif
+#endif
+
+/* Non-temporal stores are used for LZDG_FLAG_STREAM where SSE2 is available */
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define LZDG_HAVE_STREAM
+#endif
 
 /* Limits for length values, based on zlib */
 #define MIN_LEN 3
 #define MAX_LEN 258
 #define NUM_LEN (MAX_LEN - MIN_LEN + 1)
 
+/* Number of bytes copy_match may write past the end of a match */
+#define COPY_SLACK 16
+
 /* Number of lengths to generate at a time */
 #define LEN_PER_CHUNK 512
 
-/* Number of literal samples to generate (must be power of 2) */
-#define SAMPLE_SIZE 16384U
+/* Number of literal samples in bulk mode, as a power of 2 */
+#define SAMPLE_BITS 14
+#define SAMPLE_SIZE (1U << SAMPLE_BITS)
+
+/* Number of length samples in bulk mode, as a power of 2 */
+#define LEN_SAMPLE_BITS 12
+#define LEN_SAMPLE_SIZE (1U << LEN_SAMPLE_BITS)
+
+/* Number of random bits used to choose between literals and match in bulk mode */
+#define TOKEN_BITS 16
+
+/* Number of literals to generate at a time from the distribution */
+#define LIT_CHUNK 64
+
+/* Largest integer exponent with a specialized kernel */
+#define MAX_INT_EXP 4
+
+/* Number of fractional bits in fixed-point values */
+#define FIX_BITS 32
+#define FIX_ONE (UINT64_C(1) << FIX_BITS)
 
 /* Block size for sampled generation */
 #define BLOCK_SIZE (1024UL * 1024)
 
+/* Maximum number of match buffers, and chunks of lengths, in a token plan */
+#define PLAN_BUFFERS 4
+
+/* Maximum number of tokens in a token plan, each length may need a literal before it */
+#define PLAN_TOKENS (2 * PLAN_BUFFERS * LEN_PER_CHUNK)
+
+/* Size of buffer for LZDG_FLAG_STREAM, the most data a token plan can cover */
+#define STREAM_BUFFER_SIZE (PLAN_BUFFERS * LEN_PER_CHUNK * (MAX_LEN + 1))
+
+/* Size of huge pages used by lzdg_alloc */
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+/* Distance between bytes touched to prefault memory in lzdg_alloc */
+#define PREFAULT_STRIDE 4096
+
+/*
+ * Called with the type and length of each token in the order of the data,
+ * by lzdg_test.c, which includes this file, to check the distributions.
+ */
+#if !defined(LZDG_TRACE_TOKEN)
+#  define LZDG_TRACE_TOKEN(type, len) ((void) 0)
+#endif
+
+/* Global PRNG state used by the generation functions */
+static struct rng_state rng_global = RNG_INITIALIZER;
+
+/**
+ * Tables used for bulk generation.
+ */
+struct sample_tables {
+	unsigned char lit[SAMPLE_SIZE];     /**< Literal quantiles */
+	unsigned char len[LEN_SAMPLE_SIZE]; /**< Length quantiles (minus MIN_LEN) */
+	uint32_t lit_threshold;             /**< Insert literals if TOKEN_BITS bits are below */
+};
+
+/* Token types in a token plan */
+enum token_type {
+	TOKEN_LITERALS,
+	TOKEN_MATCH
+};
+
+/**
+ * Token plan for part of a block in bulk mode.
+ *
+ * Stored as a structure of arrays, so the passes over it only touch the
+ * arrays they need.
+ */
+struct token_plan {
+	unsigned char type[PLAN_TOKENS]; /**< Token type (`enum token_type`) */
+	uint16_t len[PLAN_TOKENS];       /**< Token length */
+	unsigned char src[PLAN_TOKENS];  /**< Match buffer index for matches */
+	size_t num_tokens;               /**< Number of tokens */
+	size_t size;                     /**< Number of bytes covered by tokens */
+	unsigned int num_buffers;        /**< Number of match buffers used */
+};
+
+/**
+ * State of token planning that carries over between plans in a block.
+ */
+struct token_planner {
+	struct rng_bits bits;           /**< Random bit reservoir */
+	unsigned int len_freq[NUM_LEN]; /**< Remaining length frequencies */
+	size_t cur_len;                 /**< Current length (minus MIN_LEN) */
+	int last_was_match;             /**< Last token was a match */
+};
+
+/**
+ * Parameters of bulk generation, set up once for a given ratio and
+ * exponents.
+ */
+struct lzdg_bulk {
+	struct sample_tables tables; /**< Bulk generation tables */
+	double lit_exp;              /**< Exponent used for distribution of literals */
+	int degenerate;              /**< Data can be generated by generate_data_degenerate */
+};
+
 /**
- * Generate random double.
+ * Return `u` raised to the power `e`.
  *
- * @note Not perfectly distributed, but more than adequate for this use.
+ * If `k` is not zero, `e` equals `k`, and the power is computed by
+ * multiplication in double precision, which gives the same result as
+ * powf in all but rare cases, for a fraction of the cost.
  *
- * @return random double in range [0;1)
+ * @param u value in range [0;1)
+ * @param e exponent
+ * @param k integer exponent, or 0 to use `e`
+ * @return `u` raised to the power `e`
  */
-static double
-rand_double(void)
+static LZDG_ALWAYS_INLINE float
+power(float u, float e, unsigned int k)
 {
-	return pcg32_random() / (UINT32_MAX + 1.0);
+	double r = u;
+	unsigned int i;
+
+	if (k == 0) {
+		return powf(u, e);
+	}
+
+	for (i = 1; i < k; ++i) {
+		r *= u;
+	}
+
+	return (float) r;
+}
+
+/**
+ * Get integer exponent for specialized kernels.
+ *
+ * @param exp exponent
+ * @return `exp` if it is an integer from 1 to MAX_INT_EXP, otherwise 0
+ */
+static unsigned int
+integer_exp(double exp)
+{
+	unsigned int k;
+
+	for (k = 1; k <= MAX_INT_EXP; ++k) {
+		if (exp == k) {
+			return k;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Generate random literals.
+ *
+ * Generic kernel for generate_literals_from_distribution, specialized on
+ * the integer exponent `k`.
+ *
+ * @see power
+ *
+ * @param rng pointer to PRNG state
+ * @param ptr pointer to where to store literals
+ * @param size number of literals to generate
+ * @param lit_exp exponent used for distribution
+ * @param k integer exponent, or 0 to use `lit_exp`
+ */
+static LZDG_ALWAYS_INLINE void
+generate_literals_kernel(struct rng_state *rng, unsigned char *ptr, size_t size, double lit_exp, unsigned int k)
+{
+	float u[LIT_CHUNK];
+	float e = (float) lit_exp;
+
+	/*
+	 * powf is called in the loop with the PRNG, which can not be
+	 * vectorized, so it is never replaced by a vector variant from libmvec,
+	 * which may round differently depending on the ISA level.
+	 */
+	if (k == 0) {
+		size_t i;
+
+		for (i = 0; i < size; ++i) {
+			unsigned int lit = (unsigned int) (256 * powf((float) rand_double(rng), e));
+
+			/* Converting to float may round up to 1.0 */
+			ptr[i] = (unsigned char) (lit < 255 ? lit : 255);
+		}
+
+		return;
+	}
+
+	while (size > 0) {
+		size_t num = size < LIT_CHUNK ? size : LIT_CHUNK;
+		size_t i;
+
+		for (i = 0; i < num; ++i) {
+			u[i] = (float) rand_double(rng);
+		}
+
+		/* Separate loop, so the multiplications can be vectorized */
+		for (i = 0; i < num; ++i) {
+			unsigned int lit = (unsigned int) (256 * power(u[i], e, k));
+
+			/* Converting to float may round up to 1.0 */
+			ptr[i] = (unsigned char) (lit < 255 ? lit : 255);
+		}
+
+		ptr += num;
+		size -= num;
+	}
 }
 
 /**
@@ -60,18 +270,247 @@ rand_double(void)
  * distribution is linear. As `lit_exp` grows, the likelihood of small values
  * increases.
  *
+ * @param rng pointer to PRNG state
  * @param ptr pointer to where to store literals
  * @param size number of literals to generate
  * @param lit_exp exponent used for distribution
  */
+LZDG_TARGET_CLONES static void
+generate_literals_from_distribution(struct rng_state *rng, unsigned char *ptr, size_t size, double lit_exp)
+{
+	switch (integer_exp(lit_exp)) {
+	case 1:
+		generate_literals_kernel(rng, ptr, size, lit_exp, 1);
+		break;
+	case 2:
+		generate_literals_kernel(rng, ptr, size, lit_exp, 2);
+		break;
+	case 3:
+		generate_literals_kernel(rng, ptr, size, lit_exp, 3);
+		break;
+	case 4:
+		generate_literals_kernel(rng, ptr, size, lit_exp, 4);
+		break;
+	default:
+		generate_literals_kernel(rng, ptr, size, lit_exp, 0);
+		break;
+	}
+}
+
+/**
+ * Generate uniformly distributed random bytes.
+ *
+ * This is the distribution of literals when `lit_exp` is 1.0, so it is used
+ * instead of generate_literals_from_distribution for incompressible data,
+ * storing all bytes of each PRNG value.
+ *
+ * @param rng pointer to PRNG state
+ * @param ptr pointer to where to store bytes
+ * @param size number of bytes to generate
+ */
 static void
-generate_literals_from_distribution(unsigned char *ptr, size_t size, double lit_exp)
+generate_random_bytes(struct rng_state *rng, unsigned char *ptr, size_t size)
 {
-	size_t i;
+	while (size >= sizeof(uint64_t)) {
+		uint64_t v = rng_next64(rng);
+		size_t i;
+
+		/* Store little-endian, so the data is the same on all platforms */
+		for (i = 0; i < sizeof(v); ++i) {
+			ptr[i] = (unsigned char) (v >> (8 * i));
+		}
 
-	for (i = 0; i < size; ++i) {
-		ptr[i] = (unsigned char) (256 * powf((float) rand_double(), (float) lit_exp));
+		ptr += sizeof(v);
+		size -= sizeof(v);
 	}
+
+	if (size > 0) {
+		uint64_t v = rng_next64(rng);
+		size_t i;
+
+		for (i = 0; i < size; ++i) {
+			ptr[i] = (unsigned char) (v >> (8 * i));
+		}
+	}
+}
+
+/*
+ * Fixed-point arithmetic for bulk mode tables.
+ *
+ * The tables are set up using only integer arithmetic, so bulk mode gives
+ * the same data for a seed regardless of platform, compiler, compiler flags
+ * and math library. Values are unsigned with FIX_BITS fractional bits.
+ */
+
+/**
+ * Values of 2^(-2^-j) for j = 1 to FIX_BITS, with FIX_BITS fractional bits.
+ */
+static const uint32_t fix_exp2_table[FIX_BITS] = {
+	0xB504F334, 0xD744FCCB, 0xEAC0C6E8, 0xF5257D15,
+	0xFA83B2DB, 0xFD3E0C0D, 0xFE9E115C, 0xFF4ECB59,
+	0xFFA75652, 0xFFD3A752, 0xFFE9D2B3, 0xFFF4E91C,
+	0xFFFA747F, 0xFFFD3A3B, 0xFFFE9D1D, 0xFFFF4E8E,
+	0xFFFFA747, 0xFFFFD3A3, 0xFFFFE9D2, 0xFFFFF4E9,
+	0xFFFFFA74, 0xFFFFFD3A, 0xFFFFFE9D, 0xFFFFFF4F,
+	0xFFFFFFA7, 0xFFFFFFD4, 0xFFFFFFEA, 0xFFFFFFF5,
+	0xFFFFFFFA, 0xFFFFFFFD, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+/**
+ * Compute base 2 logarithm of `k` in fixed-point.
+ *
+ * Computes one bit of the fraction at a time by squaring.
+ *
+ * @param k value, at least 1 and at most 2^31
+ * @return log2(k) with FIX_BITS fractional bits
+ */
+static uint64_t
+fix_log2(uint32_t k)
+{
+	uint64_t r;
+	uint64_t y;
+	uint64_t b;
+	unsigned int n = 0;
+
+	while ((k >> n) > 1) {
+		n++;
+	}
+
+	r = (uint64_t) n << FIX_BITS;
+
+	/* y = k / 2^n, in [1;2) with 31 fractional bits */
+	y = ((uint64_t) k << 31) >> n;
+
+	for (b = FIX_ONE >> 1; b > 0; b >>= 1) {
+		y = (y * y) >> 31;
+
+		if (y >= UINT64_C(1) << 32) {
+			y >>= 1;
+			r += b;
+		}
+	}
+
+	return r;
+}
+
+/**
+ * Compute 2 raised to the power `-m` in fixed-point.
+ *
+ * Multiplies together the powers of 2 for each bit of the fraction of `m`.
+ *
+ * @param m exponent with FIX_BITS fractional bits
+ * @return 2^-m with FIX_BITS fractional bits
+ */
+static uint64_t
+fix_exp2_neg(uint64_t m)
+{
+	uint64_t r = FIX_ONE;
+	unsigned int j;
+
+	if ((m >> FIX_BITS) >= FIX_BITS) {
+		return 0;
+	}
+
+	for (j = 0; j < FIX_BITS; ++j) {
+		if (m & (UINT64_C(1) << (FIX_BITS - 1 - j))) {
+			r = (r * fix_exp2_table[j]) >> FIX_BITS;
+		}
+	}
+
+	return r >> (m >> FIX_BITS);
+}
+
+/**
+ * Convert `x` to fixed-point with 16 fractional bits.
+ *
+ * Scaling by a power of 2 and truncating is exact, so the result does not
+ * depend on floating-point rounding.
+ *
+ * @param x value
+ * @return `x` with 16 fractional bits, clamped to range [1;2^48]
+ */
+static uint64_t
+fix16_from_double(double x)
+{
+	double v = x * 65536.0;
+
+	if (!(v >= 1.0)) {
+		return 1;
+	}
+
+	if (v >= 281474976710656.0) {
+		return UINT64_C(1) << 48;
+	}
+
+	return (uint64_t) v;
+}
+
+/**
+ * Fill `samples` with values at evenly spaced quantiles.
+ *
+ * Entry `i` is the value at quantile `(i + 0.5) / num_samples` of the
+ * distribution of `num_values * u^exp`, with `u` uniform in [0;1), which is
+ * the distribution used for literals and lengths. Selecting uniformly from
+ * `samples` follows that distribution without the noise of filling
+ * `samples` with random values.
+ *
+ * Since the distribution is monotone, the table consists of a run of each
+ * value, and only the start of each run needs to be computed. Value `k`
+ * starts at the first `i` where `(i + 0.5) / num_samples` is at least
+ * `(k / num_values)^(1 / exp)`, which is computed in fixed-point as
+ * `2^-((log2(num_values) - log2(k)) / exp)`.
+ *
+ * @param samples pointer to array of `num_samples` values
+ * @param num_samples number of samples, at most 2^16
+ * @param num_values number of possible values, at most 256
+ * @param exp exponent used for distribution, with 16 fractional bits
+ */
+static void
+generate_samples(unsigned char *samples, size_t num_samples, unsigned int num_values, uint64_t exp)
+{
+	uint64_t log_values = fix_log2(num_values);
+	size_t start = 0;
+	unsigned int k;
+
+	for (k = 0; k < num_values; ++k) {
+		size_t end = num_samples;
+
+		if (k < num_values - 1) {
+			uint64_t m = ((log_values - fix_log2(k + 1)) << 16) / exp;
+			uint64_t x = num_samples * fix_exp2_neg(m);
+
+			/* end = ceil(x - 0.5), with x at most num_samples */
+			end = x <= FIX_ONE / 2 ? 0 : (size_t) ((x - FIX_ONE / 2 + FIX_ONE - 1) >> FIX_BITS);
+		}
+
+		if (end > start) {
+			memset(samples + start, (int) k, end - start);
+			start = end;
+		}
+	}
+}
+
+/**
+ * Set up tables for bulk generation.
+ *
+ * The parameters are converted to fixed-point, and all further computation
+ * uses integers.
+ *
+ * @param tables pointer to tables
+ * @param ratio desired compression ratio
+ * @param len_exp exponent used for distribution of lenghts
+ * @param lit_exp exponent used for distribution of literals
+ */
+static void
+generate_sample_tables(struct sample_tables *tables, double ratio, double len_exp, double lit_exp)
+{
+	uint64_t ratio16 = fix16_from_double(ratio);
+
+	generate_samples(tables->lit, SAMPLE_SIZE, 256, fix16_from_double(lit_exp));
+	generate_samples(tables->len, LEN_SAMPLE_SIZE, NUM_LEN, fix16_from_double(len_exp));
+
+	/* Round (1 << TOKEN_BITS) / ratio to nearest */
+	tables->lit_threshold = (uint32_t) (((UINT64_C(1) << (TOKEN_BITS + 16)) + ratio16 / 2) / ratio16);
 }
 
 /**
@@ -79,41 +518,72 @@ generate_literals_from_distribution(unsigned char *ptr, size_t size, double lit_
  *
  * Generate literals by selecting randomly from `samples`.
  *
+ * @param rng pointer to PRNG state
+ * @param bits pointer to random bit reservoir
  * @param ptr pointer to where to store literals
  * @param size number of literals to generate
- * @param samples pointer to array of SAMPLE_SIZE random literals
+ * @param samples pointer to array of SAMPLE_SIZE literals
  */
-static void
-generate_literals_from_samples(unsigned char *ptr, size_t size, const unsigned char *samples)
+static inline void
+generate_literals_from_samples(struct rng_state *rng, struct rng_bits *bits, unsigned char *ptr, size_t size, const unsigned char *samples)
 {
-	size_t i;
+	/* Use up the reservoir first */
+	while (size > 0 && bits->avail >= SAMPLE_BITS) {
+		*ptr++ = samples[rng_take_bits(rng, bits, SAMPLE_BITS)];
+		size--;
+	}
+
+	/* Take as many literals as fit from each 64-bit value */
+	while (size >= 64 / SAMPLE_BITS) {
+		uint64_t v = rng_next64(rng);
+		size_t i;
+
+		for (i = 0; i < 64 / SAMPLE_BITS; ++i) {
+			ptr[i] = samples[(v >> (i * SAMPLE_BITS)) & (SAMPLE_SIZE - 1)];
+		}
+
+		ptr += 64 / SAMPLE_BITS;
+		size -= 64 / SAMPLE_BITS;
+	}
 
-	for (i = 0; i < size; ++i) {
-		ptr[i] = samples[pcg32_random() % SAMPLE_SIZE];
+	while (size > 0) {
+		*ptr++ = samples[rng_take_bits(rng, bits, SAMPLE_BITS)];
+		size--;
 	}
 }
 
 /**
- * Generate random literals.
+ * Generate random lengths.
  *
- * If `samples` is `NULL` generate literals using `lit_exp`, otherwise
- * select random literals from `samples`.
+ * Generic kernel for generate_lengths_from_distribution, specialized on
+ * the integer exponent `k`.
  *
- * @see generate_literals_from_distribution
- * @see generate_literals_from_samples
+ * @see power
  *
- * @param ptr pointer to where to store literals
- * @param size number of literals to generate
- * @param samples pointer to array of SAMPLE_SIZE random literals or NULL
+ * @param rng pointer to PRNG state
+ * @param len_freq pointer to where to store length frequencies
+ * @param num number of lengths to generate
+ * @param len_exp exponent used for distribution
+ * @param k integer exponent, or 0 to use `len_exp`
  */
-static void
-generate_literals(unsigned char *ptr, size_t size, double lit_exp, const unsigned char *samples)
+static LZDG_ALWAYS_INLINE void
+generate_lengths_kernel(struct rng_state *rng, unsigned int len_freq[NUM_LEN], size_t num, double len_exp, unsigned int k)
 {
-	if (samples) {
-		generate_literals_from_samples(ptr, size, samples);
+	size_t i;
+
+	for (i = 0; i < NUM_LEN; ++i) {
+		len_freq[i] = 0;
 	}
-	else {
-		generate_literals_from_distribution(ptr, size, lit_exp);
+
+	for (i = 0; i < num; ++i) {
+		size_t len = (size_t) (NUM_LEN * power((float) rand_double(rng), (float) len_exp, k));
+
+		/* Converting to float may round up to 1.0 */
+		if (len >= NUM_LEN) {
+			len = NUM_LEN - 1;
+		}
+
+		len_freq[len]++;
 	}
 }
 
@@ -127,12 +597,46 @@ generate_literals(unsigned char *ptr, size_t size, double lit_exp, const unsigne
  * @note The size of the frequency table is `NUM_LEN`, the range of possible
  * length values, while `num` is the number of length values to generate.
  *
+ * @param rng pointer to PRNG state
  * @param len_freq pointer to where to store length frequencies
  * @param num number of lengths to generate
  * @param len_exp exponent used for distribution
  */
-static void
-generate_lengths(unsigned int len_freq[NUM_LEN], size_t num, double len_exp)
+LZDG_TARGET_CLONES static void
+generate_lengths_from_distribution(struct rng_state *rng, unsigned int len_freq[NUM_LEN], size_t num, double len_exp)
+{
+	switch (integer_exp(len_exp)) {
+	case 1:
+		generate_lengths_kernel(rng, len_freq, num, len_exp, 1);
+		break;
+	case 2:
+		generate_lengths_kernel(rng, len_freq, num, len_exp, 2);
+		break;
+	case 3:
+		generate_lengths_kernel(rng, len_freq, num, len_exp, 3);
+		break;
+	case 4:
+		generate_lengths_kernel(rng, len_freq, num, len_exp, 4);
+		break;
+	default:
+		generate_lengths_kernel(rng, len_freq, num, len_exp, 0);
+		break;
+	}
+}
+
+/**
+ * Generate random lengths from `samples`.
+ *
+ * Generate length frequencies by selecting randomly from `samples`.
+ *
+ * @param rng pointer to PRNG state
+ * @param bits pointer to random bit reservoir
+ * @param len_freq pointer to where to store length frequencies
+ * @param num number of lengths to generate
+ * @param samples pointer to array of LEN_SAMPLE_SIZE lengths (minus MIN_LEN)
+ */
+static inline void
+generate_lengths_from_samples(struct rng_state *rng, struct rng_bits *bits, unsigned int len_freq[NUM_LEN], size_t num, const unsigned char *samples)
 {
 	size_t i;
 
@@ -141,50 +645,125 @@ generate_lengths(unsigned int len_freq[NUM_LEN], size_t num, double len_exp)
 	}
 
 	for (i = 0; i < num; ++i) {
-		size_t len = (size_t) (NUM_LEN * powf((float) rand_double(), (float) len_exp));
+		len_freq[samples[rng_take_bits(rng, bits, LEN_SAMPLE_BITS)]]++;
+	}
+}
+
+/**
+ * Copy `size` bytes from `src` to `dst` with non-temporal stores.
+ *
+ * The stores bypass the cache, so writing data that will not be read
+ * again soon does not evict other data, or read the destination into the
+ * cache first. Falls back to memcpy without SSE2.
+ *
+ * @param dst pointer to destination
+ * @param src pointer to source, not overlapping `dst`
+ * @param size number of bytes to copy
+ */
+static void
+stream_copy(unsigned char *dst, const unsigned char *src, size_t size)
+{
+#if defined(LZDG_HAVE_STREAM)
+	size_t head = (size_t) ((16 - ((uintptr_t) dst & 15)) & 15);
 
-		assert(len < NUM_LEN);
+	if (head > size) {
+		head = size;
+	}
 
-		len_freq[len]++;
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	size -= head;
+
+	while (size >= 16) {
+		_mm_stream_si128((__m128i *) dst, _mm_loadu_si128((const __m128i *) src));
+		dst += 16;
+		src += 16;
+		size -= 16;
 	}
+
+	memcpy(dst, src, size);
+
+	_mm_sfence();
+#else
+	memcpy(dst, src, size);
+#endif
 }
 
 /**
- * Generate compressible data.
+ * Copy match of `len` bytes from `src` to `dst`.
+ *
+ * Copies in chunks of 16 bytes, which compilers turn into single vector
+ * loads and stores, instead of calling memcpy with a variable length. It
+ * may read and write up to `COPY_SLACK - 1` bytes past the end of the match.
  *
- * Internal function that performs the actual data generation.
+ * @param dst pointer to where to store match
+ * @param src pointer to match source, not overlapping `dst`
+ * @param len length of match, at least 1
+ */
+static inline void
+copy_match(unsigned char *dst, const unsigned char *src, size_t len)
+{
+	const unsigned char *end = dst + len;
+
+	do {
+		memcpy(dst, src, 16);
+		dst += 16;
+		src += 16;
+	} while (dst < end);
+}
+
+/**
+ * Generate compressible data.
  *
- * If `samples` is `NULL` generate literals using `lit_exp`, otherwise
- * select random literals from `samples`.
+ * Internal function that performs the actual data generation, generating
+ * literals and lengths using `lit_exp` and `len_exp`.
  *
+ * @param rng pointer to PRNG state
  * @param ptr pointer to where to store generated data
  * @param size number of bytes to generate
  * @param ratio desired compression ratio
  * @param len_exp exponent used for distribution of lenghts
  * @param lit_exp exponent used for distribution of literals
- * @param samples pointer to array of SAMPLE_SIZE random literals or NULL
  */
-static void
-generate_data_internal(void *ptr, size_t size, double ratio, double len_exp, double lit_exp, const unsigned char *samples)
+LZDG_TARGET_CLONES static void
+generate_data_internal(struct rng_state *rng, void *ptr, size_t size, double ratio, double len_exp, double lit_exp)
 {
 	unsigned int len_freq[NUM_LEN];
-	unsigned char buffer[MAX_LEN];
+	unsigned char buffer[MAX_LEN + COPY_SLACK];
 	unsigned char *p = (unsigned char *) ptr;
 	size_t cur_len = 0;
 	size_t i = 0;
 	int last_was_match = 0;
 
+	/* If ratio is at most 1.0, all tokens are literals */
+	if (ratio <= 1.0) {
+		LZDG_TRACE_TOKEN(TOKEN_LITERALS, size);
+
+		if (lit_exp == 1.0) {
+			generate_random_bytes(rng, p, size);
+		}
+		else {
+			generate_literals_from_distribution(rng, p, size, lit_exp);
+		}
+
+		return;
+	}
+
 	len_freq[0] = 0;
 
+	/* Only read by copy_match past the end of a match */
+	memset(buffer + MAX_LEN, 0, COPY_SLACK);
+
 	while (i < size) {
 		size_t len;
 
 		/* Find next length with non-zero frequency */
 		while (len_freq[cur_len] == 0) {
 			if (cur_len == 0) {
-				generate_literals(buffer, MAX_LEN, lit_exp, samples);
+				generate_literals_from_distribution(rng, buffer, MAX_LEN, lit_exp);
 
-				generate_lengths(len_freq, LEN_PER_CHUNK, len_exp);
+				generate_lengths_from_distribution(rng, len_freq, LEN_PER_CHUNK, len_exp);
 
 				cur_len = NUM_LEN;
 			}
@@ -200,26 +779,38 @@ generate_data_internal(void *ptr, size_t size, double ratio, double len_exp, dou
 			len = size - i;
 		}
 
-		if (rand_double() < 1.0 / ratio) {
+		if (rand_double(rng) < 1.0 / ratio) {
 			/* Insert len literals */
-			generate_literals(p, len, lit_exp, samples);
+			generate_literals_from_distribution(rng, p, len, lit_exp);
+
+			LZDG_TRACE_TOKEN(TOKEN_LITERALS, len);
 
 			last_was_match = 0;
 		}
 		else {
 			/* Insert literal to break up matches */
 			if (last_was_match) {
-				generate_literals(p, 1, lit_exp, samples);
+				generate_literals_from_distribution(rng, p, 1, lit_exp);
 				i++;
 				p++;
 
+				LZDG_TRACE_TOKEN(TOKEN_LITERALS, 1);
+
 				if (len > size - i) {
 					len = size - i;
 				}
 			}
 
-			/* Insert match of length len */
-			memcpy(p, buffer, len);
+			/* Insert match of length len, the rest of the output
+			 * overwrites what copy_match writes past the end */
+			if (len > 0 && size - i >= len + COPY_SLACK) {
+				copy_match(p, buffer, len);
+			}
+			else {
+				memcpy(p, buffer, len);
+			}
+
+			LZDG_TRACE_TOKEN(TOKEN_MATCH, len);
 
 			last_was_match = 1;
 		}
@@ -229,27 +820,482 @@ generate_data_internal(void *ptr, size_t size, double ratio, double len_exp, dou
 	}
 }
 
+/**
+ * Add token to `plan`.
+ *
+ * @param plan pointer to token plan
+ * @param type token type
+ * @param len token length
+ */
+static inline void
+plan_add_token(struct token_plan *plan, enum token_type type, size_t len)
+{
+	size_t t = plan->num_tokens++;
+
+	plan->type[t] = (unsigned char) type;
+	plan->len[t] = (uint16_t) len;
+	plan->src[t] = (unsigned char) (plan->num_buffers - 1);
+	plan->size += len;
+
+	LZDG_TRACE_TOKEN(type, len);
+}
+
+/**
+ * Plan tokens for up to `size` bytes of data in bulk mode.
+ *
+ * Makes the random choices of token types and lengths, in the same way as
+ * generate_data_internal, and records them in `plan` without producing any
+ * data. A plan uses up to PLAN_BUFFERS chunks of lengths, each with its own
+ * match buffer, and ends before the chunk after that, so each plan starts
+ * with a new chunk.
+ *
+ * @param rng pointer to PRNG state
+ * @param pl pointer to planner state
+ * @param plan pointer to where to store token plan
+ * @param size maximum number of bytes to plan
+ * @param tables pointer to bulk generation tables
+ */
+static inline void
+plan_tokens(struct rng_state *rng, struct token_planner *pl, struct token_plan *plan, size_t size, const struct sample_tables *tables)
+{
+	plan->num_tokens = 0;
+	plan->size = 0;
+	plan->num_buffers = 0;
+
+	while (plan->size < size) {
+		size_t len;
+
+		/* Find next length with non-zero frequency */
+		while (pl->len_freq[pl->cur_len] == 0) {
+			if (pl->cur_len == 0) {
+				if (plan->num_buffers == PLAN_BUFFERS) {
+					break;
+				}
+
+				generate_lengths_from_samples(rng, &pl->bits, pl->len_freq, LEN_PER_CHUNK, tables->len);
+
+				plan->num_buffers++;
+
+				pl->cur_len = NUM_LEN;
+			}
+
+			pl->cur_len--;
+		}
+
+		if (pl->len_freq[pl->cur_len] == 0) {
+			/* Plan is full */
+			break;
+		}
+
+		len = MIN_LEN + pl->cur_len;
+
+		pl->len_freq[pl->cur_len]--;
+
+		if (len > size - plan->size) {
+			len = size - plan->size;
+		}
+
+		if (rng_take_bits(rng, &pl->bits, TOKEN_BITS) < tables->lit_threshold) {
+			plan_add_token(plan, TOKEN_LITERALS, len);
+
+			pl->last_was_match = 0;
+		}
+		else {
+			/* Insert literal to break up matches */
+			if (pl->last_was_match) {
+				plan_add_token(plan, TOKEN_LITERALS, 1);
+
+				if (len > size - plan->size) {
+					len = size - plan->size;
+				}
+			}
+
+			plan_add_token(plan, TOKEN_MATCH, len);
+
+			pl->last_was_match = 1;
+		}
+	}
+}
+
+/**
+ * Produce the data described by `plan`.
+ *
+ * Works in separate passes over the plan: generate match buffers, copy all
+ * matches, then generate all literals. Matches are copied in order with
+ * copy_match, and the bytes it writes past the end of a match are
+ * overwritten by the following matches and literals.
+ *
+ * @param rng pointer to PRNG state
+ * @param bits pointer to random bit reservoir
+ * @param ptr pointer to where to store generated data
+ * @param plan pointer to token plan
+ * @param tables pointer to bulk generation tables
+ */
+static inline void
+materialize_plan(struct rng_state *rng, struct rng_bits *bits, unsigned char *ptr, const struct token_plan *plan, const struct sample_tables *tables)
+{
+	unsigned char buffers[PLAN_BUFFERS][MAX_LEN + COPY_SLACK];
+	size_t offs;
+	size_t t;
+	unsigned int b;
+
+	for (b = 0; b < plan->num_buffers; ++b) {
+		generate_literals_from_samples(rng, bits, buffers[b], MAX_LEN, tables->lit);
+
+		/* Only read by copy_match past the end of a match */
+		memset(buffers[b] + MAX_LEN, 0, COPY_SLACK);
+	}
+
+	for (t = 0, offs = 0; t < plan->num_tokens; offs += plan->len[t++]) {
+		size_t len = plan->len[t];
+
+		if (plan->type[t] != TOKEN_MATCH) {
+			continue;
+		}
+
+		if (plan->size - offs >= len + COPY_SLACK) {
+			copy_match(ptr + offs, buffers[plan->src[t]], len);
+		}
+		else {
+			memcpy(ptr + offs, buffers[plan->src[t]], len);
+		}
+	}
+
+	for (t = 0, offs = 0; t < plan->num_tokens; offs += plan->len[t++]) {
+		if (plan->type[t] == TOKEN_LITERALS) {
+			generate_literals_from_samples(rng, bits, ptr + offs, plan->len[t], tables->lit);
+		}
+	}
+}
+
+/**
+ * Generate compressible data in bulk mode.
+ *
+ * Generates the data in two steps, first planning tokens for part of the
+ * data, then producing the bytes for that plan, which keeps the random
+ * choices out of the loops that write the data.
+ *
+ * If `stream` is not `NULL`, each plan is produced in `stream`, and then
+ * copied to `ptr` with non-temporal stores.
+ *
+ * @param rng pointer to PRNG state
+ * @param ptr pointer to where to store generated data
+ * @param size number of bytes to generate
+ * @param tables pointer to bulk generation tables
+ * @param stream pointer to buffer of STREAM_BUFFER_SIZE bytes or NULL
+ */
+LZDG_TARGET_CLONES static void
+generate_data_planned(struct rng_state *rng, void *ptr, size_t size, const struct sample_tables *tables, unsigned char *stream)
+{
+	struct token_plan plan;
+	struct token_planner pl;
+	struct rng_bits bits = { 0, 0 };
+	unsigned char *p = (unsigned char *) ptr;
+
+	pl.bits = bits;
+	pl.len_freq[0] = 0;
+	pl.cur_len = 0;
+	pl.last_was_match = 0;
+
+	while (size > 0) {
+		plan_tokens(rng, &pl, &plan, size, tables);
+
+		if (stream) {
+			materialize_plan(rng, &bits, stream, &plan, tables);
+
+			stream_copy(p, stream, plan.size);
+		}
+		else {
+			materialize_plan(rng, &bits, p, &plan, tables);
+		}
+
+		p += plan.size;
+		size -= plan.size;
+	}
+}
+
 void
-lzdg_generate_data(void *ptr, size_t size, double ratio, double len_exp, double lit_exp)
+lzdg_seed(uint64_t seed)
+{
+	rng_seed(&rng_global, seed);
+}
+
+const char *
+lzdg_rng_name(void)
 {
-	generate_data_internal(ptr, size, ratio, len_exp, lit_exp, NULL);
+	return RNG_NAME;
 }
 
 void
-lzdg_generate_data_bulk(void *ptr, size_t size, double ratio, double len_exp, double lit_exp)
+lzdg_generate_data(void *ptr, size_t size, double ratio, double len_exp, double lit_exp)
+{
+	struct rng_state rng = rng_global;
+
+	generate_data_internal(&rng, ptr, size, ratio, len_exp, lit_exp);
+
+	rng_global = rng;
+}
+
+/**
+ * Check if bulk mode data takes a simple form.
+ *
+ * @see generate_data_degenerate
+ *
+ * @param tables pointer to bulk generation tables
+ * @return non-zero if data can be generated by generate_data_degenerate
+ */
+static int
+is_degenerate(const struct sample_tables *tables)
+{
+	return tables->lit[0] == tables->lit[SAMPLE_SIZE - 1]
+	    || tables->lit_threshold >= 1UL << TOKEN_BITS;
+}
+
+/**
+ * Generate data for bulk mode settings where it takes a simple form.
+ *
+ * If all literals are the same value, so is the data. If all tokens are
+ * literals, the data is just literals, which are uniform random bytes if
+ * `lit_exp` is 1.0.
+ *
+ * @note Generating in parts gives the same data as one call if each
+ * part except the last is a multiple of 8 bytes.
+ *
+ * @param rng pointer to PRNG state
+ * @param bits pointer to random bit reservoir
+ * @param ptr pointer to where to store generated data
+ * @param size number of bytes to generate
+ * @param lit_exp exponent used for distribution of literals
+ * @param tables pointer to bulk generation tables
+ */
+static void
+generate_data_degenerate(struct rng_state *rng, struct rng_bits *bits, unsigned char *ptr, size_t size, double lit_exp, const struct sample_tables *tables)
 {
-	unsigned char samples[SAMPLE_SIZE];
+	LZDG_TRACE_TOKEN(TOKEN_LITERALS, size);
+
+	if (tables->lit[0] == tables->lit[SAMPLE_SIZE - 1]) {
+		memset(ptr, tables->lit[0], size);
+	}
+	else if (lit_exp == 1.0) {
+		generate_random_bytes(rng, ptr, size);
+	}
+	else {
+		generate_literals_from_samples(rng, bits, ptr, size, tables->lit);
+	}
+}
+
+/**
+ * Set up `bulk` for generating data with the given parameters.
+ *
+ * @param bulk pointer to bulk parameters
+ * @param ratio desired compression ratio
+ * @param len_exp exponent used for distribution of lenghts
+ * @param lit_exp exponent used for distribution of literals
+ */
+static void
+setup_bulk(struct lzdg_bulk *bulk, double ratio, double len_exp, double lit_exp)
+{
+	generate_sample_tables(&bulk->tables, ratio, len_exp, lit_exp);
+
+	bulk->lit_exp = lit_exp;
+	bulk->degenerate = is_degenerate(&bulk->tables);
+}
+
+/**
+ * Generate compressible data in bulk.
+ *
+ * If `stream` is not `NULL`, the data is produced in `stream` and copied
+ * to `ptr` with non-temporal stores, in parts that give the same data as
+ * writing it directly.
+ *
+ * @see lzdg_generate_data_bulk
+ *
+ * @param rng pointer to PRNG state
+ * @param ptr pointer to where to store generated data
+ * @param size number of bytes to generate
+ * @param bulk pointer to bulk parameters
+ * @param stream pointer to buffer of STREAM_BUFFER_SIZE bytes or NULL
+ */
+static void
+generate_data_bulk(struct rng_state *rng, void *ptr, size_t size, const struct lzdg_bulk *bulk, unsigned char *stream)
+{
+	const struct sample_tables *tables = &bulk->tables;
+	struct rng_bits bits = { 0, 0 };
 	unsigned char *p = (unsigned char *) ptr;
 	size_t offs = 0;
 
 	while (offs < size) {
-		size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+		size_t num;
+
+		if (!bulk->degenerate) {
+			num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+
+			generate_data_planned(rng, p + offs, num, tables, stream);
+		}
+		else if (stream) {
+			num = size - offs > STREAM_BUFFER_SIZE ? STREAM_BUFFER_SIZE : size - offs;
 
-		/* Fill samples with random literals following the lit_exp distribution */
-		generate_literals(samples, SAMPLE_SIZE, lit_exp, NULL);
+			generate_data_degenerate(rng, &bits, stream, num, bulk->lit_exp, tables);
+
+			stream_copy(p + offs, stream, num);
+		}
+		else {
+			num = size - offs;
 
-		generate_data_internal(p + offs, num, ratio, len_exp, lit_exp, samples);
+			generate_data_degenerate(rng, &bits, p + offs, num, bulk->lit_exp, tables);
+		}
 
 		offs += num;
 	}
 }
+
+void
+lzdg_generate_data_bulk(void *ptr, size_t size, double ratio, double len_exp, double lit_exp)
+{
+	struct rng_state rng = rng_global;
+	struct lzdg_bulk bulk;
+
+	setup_bulk(&bulk, ratio, len_exp, lit_exp);
+
+	generate_data_bulk(&rng, ptr, size, &bulk, NULL);
+
+	rng_global = rng;
+}
+
+void
+lzdg_generate_block(void *ptr, size_t size, double ratio, double len_exp, double lit_exp,
+                    uint64_t seed, uint64_t index, unsigned int flags)
+{
+	struct rng_state rng;
+
+	rng_seed_block(&rng, seed, index);
+
+	if (flags & LZDG_FLAG_BULK) {
+		struct lzdg_bulk bulk;
+		unsigned char *stream = NULL;
+
+		setup_bulk(&bulk, ratio, len_exp, lit_exp);
+
+		/* Without memory for the buffer, write the data directly */
+		if (flags & LZDG_FLAG_STREAM) {
+			stream = (unsigned char *) malloc(STREAM_BUFFER_SIZE);
+		}
+
+		generate_data_bulk(&rng, ptr, size, &bulk, stream);
+
+		free(stream);
+	}
+	else {
+		generate_data_internal(&rng, ptr, size, ratio, len_exp, lit_exp);
+	}
+}
+
+struct lzdg_bulk *
+lzdg_bulk_create(double ratio, double len_exp, double lit_exp)
+{
+	struct lzdg_bulk *bulk = (struct lzdg_bulk *) malloc(sizeof(*bulk));
+
+	if (bulk != NULL) {
+		setup_bulk(bulk, ratio, len_exp, lit_exp);
+	}
+
+	return bulk;
+}
+
+void
+lzdg_bulk_generate(const struct lzdg_bulk *bulk, void *ptr, size_t size, uint64_t seed, uint64_t index)
+{
+	struct rng_state rng;
+
+	rng_seed_block(&rng, seed, index);
+
+	generate_data_bulk(&rng, ptr, size, bulk, NULL);
+}
+
+void
+lzdg_bulk_free(struct lzdg_bulk *bulk)
+{
+	free(bulk);
+}
+
+/**
+ * Touch every page of `ptr`, from multiple threads with OpenMP.
+ *
+ * @param ptr pointer to memory
+ * @param size size of memory in bytes
+ */
+static void
+prefault(unsigned char *ptr, size_t size)
+{
+	long num_pages = (long) ((size + PREFAULT_STRIDE - 1) / PREFAULT_STRIDE);
+	long i;
+
+#pragma omp parallel for schedule(static)
+	for (i = 0; i < num_pages; ++i) {
+		ptr[(size_t) i * PREFAULT_STRIDE] = 0;
+	}
+}
+
+void *
+lzdg_alloc(size_t size)
+{
+#if defined(__linux__)
+	size_t map_size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+	void *ptr;
+
+	if (size == 0 || map_size < size) {
+		return NULL;
+	}
+
+#  if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+	ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+	           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+#  else
+	ptr = MAP_FAILED;
+#  endif
+
+	/* Without reserved 2 MiB pages, ask for transparent huge pages */
+	if (ptr == MAP_FAILED) {
+		ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+		           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (ptr == MAP_FAILED) {
+			return NULL;
+		}
+
+#  if defined(MADV_HUGEPAGE)
+		madvise(ptr, map_size, MADV_HUGEPAGE);
+#  endif
+	}
+
+	prefault((unsigned char *) ptr, map_size);
+
+	return ptr;
+#else
+	void *ptr = malloc(size);
+
+	if (ptr != NULL) {
+		prefault((unsigned char *) ptr, size);
+	}
+
+	return ptr;
+#endif
+}
+
+int
+lzdg_free(void *ptr, size_t size)
+{
+	if (ptr == NULL) {
+		return 0;
+	}
+
+#if defined(__linux__)
+	return munmap(ptr, (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1)) == 0 ? 0 : -1;
+#else
+	(void) size;
+
+	free(ptr);
+
+	return 0;
+#endif
+}
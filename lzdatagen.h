@@ -22,6 +22,7 @@
 #define LZDATAGEN_H_INCLUDED
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,6 +33,27 @@ extern "C" {
 #define LZDG_VER_PATCH 0        /**< Patch version number */
 #define LZDG_VER_STRING "0.2.0" /**< Version number as a string */
 
+#define LZDG_FLAG_BULK   0x0001U /**< Use method of `lzdg_generate_data_bulk` */
+#define LZDG_FLAG_STREAM 0x0002U /**< Write bulk data with non-temporal stores */
+
+/**
+ * Seed the PRNG used by the generation functions.
+ *
+ * The same seed always produces the same data for a given PRNG backend.
+ *
+ * @param seed 64-bit seed value
+ */
+void
+lzdg_seed(uint64_t seed);
+
+/**
+ * Get name of the PRNG backend selected at compile time.
+ *
+ * @return name of PRNG backend, e.g. "pcg32"
+ */
+const char *
+lzdg_rng_name(void);
+
 /**
  * Generate compressible data.
  *
@@ -57,7 +79,13 @@ lzdg_generate_data(void *ptr, size_t size, double ratio, double len_exp, double
  * Generate compressible data in bulk.
  *
  * This uses a faster but less precise method of generating the literals,
- * and is useful when generating large amounts of data.
+ * and is useful when generating large amounts of data. Literals are selected
+ * from a table of evenly spaced quantiles of the literal distribution.
+ *
+ * Only integer arithmetic is used once the parameters are converted to
+ * fixed-point, so for a given PRNG backend the same seed gives the same
+ * data on all platforms, compilers and math libraries, unlike
+ * `lzdg_generate_data`, which depends on the results of `powf`.
  *
  * @see lzdg_generate_data
  *
@@ -70,6 +98,134 @@ lzdg_generate_data(void *ptr, size_t size, double ratio, double len_exp, double
 void
 lzdg_generate_data_bulk(void *ptr, size_t size, double ratio, double len_exp, double lit_exp);
 
+/**
+ * Generate compressible data for block `index` of a stream.
+ *
+ * The data depends only on the parameters, `seed` and `index`, and not on
+ * the state set by `lzdg_seed`, so blocks of a stream can be generated in
+ * any order, and from multiple threads at once.
+ *
+ * With the counter-based Philox PRNG backend, the PRNG for each block is
+ * the key `seed` with a counter starting at `index << 64`, otherwise `seed`
+ * and `index` are mixed to seed the PRNG.
+ *
+ * If `flags` contains both `LZDG_FLAG_BULK` and `LZDG_FLAG_STREAM`, the
+ * data is written to `ptr` with non-temporal stores, which bypass the CPU
+ * caches. This is faster for filling buffers much larger than the last
+ * level cache, and gives the same data. `LZDG_FLAG_STREAM` is ignored
+ * without `LZDG_FLAG_BULK`.
+ *
+ * @see lzdg_generate_data
+ *
+ * @param ptr pointer to where to store generated data
+ * @param size number of bytes to generate
+ * @param ratio desired compression ratio
+ * @param len_exp exponent used for distribution of lenghts
+ * @param lit_exp exponent used for distribution of literals
+ * @param seed 64-bit seed value of stream
+ * @param index index of block in stream
+ * @param flags zero or a combination of `LZDG_FLAG_BULK` and `LZDG_FLAG_STREAM`
+ */
+void
+lzdg_generate_block(void *ptr, size_t size, double ratio, double len_exp, double lit_exp,
+                    uint64_t seed, uint64_t index, unsigned int flags);
+
+/**
+ * Allocate memory for a large buffer of generated data.
+ *
+ * On Linux, the memory is mapped with 2 MiB huge pages if any are reserved,
+ * otherwise with transparent huge pages if enabled, which reduces TLB
+ * misses when filling it. All pages are touched before returning, from
+ * multiple threads if built with OpenMP, so page faults are not taken
+ * during generation.
+ *
+ * @param size number of bytes to allocate
+ * @return pointer to memory, or `NULL` on failure
+ */
+void *
+lzdg_alloc(size_t size);
+
+/**
+ * Free memory allocated with `lzdg_alloc`.
+ *
+ * @param ptr pointer returned by `lzdg_alloc`, or `NULL`
+ * @param size number of bytes passed to `lzdg_alloc`
+ * @return 0 on success, -1 if the memory could not be unmapped
+ */
+int
+lzdg_free(void *ptr, size_t size);
+
+/**
+ * Model of structured data, see `lzdg_model_create`.
+ */
+struct lzdg_model;
+
+/**
+ * Get name of model type `i`.
+ *
+ * @param i index of model type, starting at 0
+ * @return name of model type, or `NULL` if `i` is past the last one
+ */
+const char *
+lzdg_model_type(size_t i);
+
+/**
+ * Get short description of model type `i`.
+ *
+ * @param i index of model type, starting at 0
+ * @return description of model type, or `NULL` if `i` is past the last one
+ */
+const char *
+lzdg_model_description(size_t i);
+
+/**
+ * Create model for generating data of type `type`.
+ *
+ * Where `lzdg_generate_data` produces data with the statistics of
+ * LZ-compressed data, models produce data with the structure of a specific
+ * kind of content, like text, which exercises the modelling stages of
+ * compressors more realistically.
+ *
+ * Options are strings of the form KEY=VALUE, see README.md for the options
+ * of each model type. Any structures the model uses, like a vocabulary,
+ * are built from `seed`.
+ *
+ * @param type name of model type
+ * @param options array of options
+ * @param num_options number of options
+ * @param seed 64-bit seed value of stream
+ * @param error pointer to where to store error message, or `NULL`
+ * @return pointer to model, or `NULL` on error
+ */
+struct lzdg_model *
+lzdg_model_create(const char *type, const char *const *options, size_t num_options,
+                  uint64_t seed, const char **error);
+
+/**
+ * Generate data for block `index` of the stream of `model`.
+ *
+ * Like `lzdg_generate_block`, the data depends only on the model and
+ * `index`, so blocks can be generated in any order, and from multiple
+ * threads at once. Models place their data as if every block is 1 MiB, so
+ * alignment of records and continuity of time and IDs across blocks only
+ * hold for blocks of that size.
+ *
+ * @param model pointer to model
+ * @param ptr pointer to where to store generated data
+ * @param size number of bytes to generate
+ * @param index index of block in stream
+ */
+void
+lzdg_model_generate(const struct lzdg_model *model, void *ptr, size_t size, uint64_t index);
+
+/**
+ * Free model created with `lzdg_model_create`.
+ *
+ * @param model pointer to model, or `NULL`
+ */
+void
+lzdg_model_destroy(struct lzdg_model *model);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,470 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZDATAGEN_HPP_INCLUDED
+#define LZDATAGEN_HPP_INCLUDED
+
+/*
+ * Header-only C++20 interface to lzdatagen.
+ *
+ * Data is generated with `lzdg_generate_block`, directly into storage
+ * provided by the caller, without any allocation. A `generator` produces a
+ * stream of blocks from a seed, where each fill is the next block.
+ */
+
+#include "lzdatagen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <streambuf>
+#include <type_traits>
+#include <vector>
+
+namespace lzdg {
+
+/**
+ * Parameters for data generation.
+ *
+ * Defaults match lzdgen. The `with_` functions throw `std::invalid_argument`
+ * if the value is out of range, and return `*this`, so they can be chained:
+ *
+ *     auto p = lzdg::params{}.with_ratio(4.0).with_lit_exp(2.0).with_bulk();
+ */
+class params {
+public:
+	/**
+	 * Set desired compression ratio.
+	 *
+	 * @param ratio compression ratio, at least 1.0
+	 */
+	params &with_ratio(double ratio)
+	{
+		if (!(ratio >= 1.0) || std::isinf(ratio)) {
+			throw std::invalid_argument("lzdg: ratio must be a finite value >= 1.0");
+		}
+
+		ratio_ = ratio;
+
+		return *this;
+	}
+
+	/**
+	 * Set exponent used for distribution of match lengths.
+	 *
+	 * @param len_exp exponent, greater than 0.0
+	 */
+	params &with_len_exp(double len_exp)
+	{
+		len_exp_ = check_exp(len_exp);
+
+		return *this;
+	}
+
+	/**
+	 * Set exponent used for distribution of literals.
+	 *
+	 * @param lit_exp exponent, greater than 0.0
+	 */
+	params &with_lit_exp(double lit_exp)
+	{
+		lit_exp_ = check_exp(lit_exp);
+
+		return *this;
+	}
+
+	/**
+	 * Use the faster bulk method, see `lzdg_generate_data_bulk`.
+	 */
+	params &with_bulk(bool bulk = true) noexcept
+	{
+		flags_ = bulk ? flags_ | LZDG_FLAG_BULK : flags_ & ~LZDG_FLAG_BULK;
+
+		return *this;
+	}
+
+	/**
+	 * Write bulk data with non-temporal stores, see `LZDG_FLAG_STREAM`.
+	 */
+	params &with_stream(bool stream = true) noexcept
+	{
+		flags_ = stream ? flags_ | LZDG_FLAG_STREAM : flags_ & ~LZDG_FLAG_STREAM;
+
+		return *this;
+	}
+
+	double ratio() const noexcept { return ratio_; }
+	double len_exp() const noexcept { return len_exp_; }
+	double lit_exp() const noexcept { return lit_exp_; }
+	unsigned int flags() const noexcept { return flags_; }
+
+private:
+	static double check_exp(double exp)
+	{
+		if (!(exp > 0.0) || std::isinf(exp)) {
+			throw std::invalid_argument("lzdg: exponent must be a finite value > 0.0");
+		}
+
+		return exp;
+	}
+
+	double ratio_ = 3.0;
+	double len_exp_ = 3.0;
+	double lit_exp_ = 3.0;
+	unsigned int flags_ = 0;
+};
+
+class chunk_view;
+
+/**
+ * Generator of a stream of compressible data.
+ *
+ * The stream is given by the seed and parameters. Each call to `fill`
+ * generates the next block of the stream, so the data depends on the sizes
+ * of the fills. Filling with blocks of 1 MiB gives the same data as
+ * `lzdgen --jobs` with the same seed.
+ *
+ * Generators do not share any state, so different generators can be used
+ * from different threads at once.
+ */
+class generator {
+public:
+	/**
+	 * Construct generator for stream given by `seed` and `p`.
+	 *
+	 * @param seed 64-bit seed value
+	 * @param p generation parameters
+	 */
+	explicit generator(std::uint64_t seed, const params &p = params{}) noexcept
+		: params_(p), seed_(seed) {}
+
+	/**
+	 * Fill `out` with the next block of the stream.
+	 *
+	 * @param out storage to fill
+	 */
+	void fill(std::span<std::byte> out) noexcept
+	{
+		if (out.empty()) {
+			return;
+		}
+
+		lzdg_generate_block(out.data(), out.size(), params_.ratio(),
+		                    params_.len_exp(), params_.lit_exp(),
+		                    seed_, index_++, params_.flags());
+	}
+
+	/**
+	 * Fill contiguous range `r` of trivially copyable values with the next
+	 * block of the stream.
+	 *
+	 * @param r range to fill, e.g. `std::vector<char>` or `std::array<uint8_t, N>`
+	 */
+	template<typename R>
+		requires std::ranges::contiguous_range<R>
+		      && std::ranges::sized_range<R>
+		      && std::is_trivially_copyable_v<std::ranges::range_value_t<R>>
+		      && (!std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<R>>>)
+	void fill(R &&r) noexcept
+	{
+		fill(std::as_writable_bytes(std::span(std::ranges::data(r), std::ranges::size(r))));
+	}
+
+	/**
+	 * Get view of `size` bytes of the stream, generated in chunks.
+	 *
+	 * Each chunk is generated into `storage` when the view is advanced, so
+	 * the previous chunk is overwritten.
+	 *
+	 * @param storage storage for chunks
+	 * @param size total number of bytes
+	 */
+	chunk_view chunks(std::span<std::byte> storage, std::uint64_t size);
+
+	const params &parameters() const noexcept { return params_; }
+	std::uint64_t seed() const noexcept { return seed_; }
+
+	/**
+	 * Get index of the block the next fill generates.
+	 */
+	std::uint64_t block_index() const noexcept { return index_; }
+
+	/**
+	 * Set index of the block the next fill generates.
+	 */
+	void seek(std::uint64_t index) noexcept { index_ = index; }
+
+private:
+	params params_;
+	std::uint64_t seed_;
+	std::uint64_t index_ = 0;
+};
+
+/**
+ * Input view of generated chunks.
+ *
+ * The elements are `std::span<const std::byte>` of the caller's storage,
+ * each holding the next block of the generator's stream. All chunks except
+ * the last are the size of the storage.
+ *
+ *     std::vector<std::byte> buf(1 << 20);
+ *
+ *     for (auto chunk : gen.chunks(buf, total)) {
+ *         consume(chunk);
+ *     }
+ */
+class chunk_view : public std::ranges::view_interface<chunk_view> {
+public:
+	class iterator {
+	public:
+		using value_type = std::span<const std::byte>;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+
+		value_type operator*() const noexcept { return view_->current_; }
+
+		iterator &operator++() noexcept
+		{
+			view_->advance();
+
+			return *this;
+		}
+
+		void operator++(int) noexcept { ++*this; }
+
+		friend bool operator==(const iterator &it, std::default_sentinel_t) noexcept
+		{
+			return it.done();
+		}
+
+	private:
+		friend class chunk_view;
+
+		explicit iterator(chunk_view *view) noexcept : view_(view) {}
+
+		bool done() const noexcept { return view_->current_.empty(); }
+
+		chunk_view *view_ = nullptr;
+	};
+
+	/**
+	 * Construct view of `size` bytes from `gen`, generated into `storage`.
+	 *
+	 * @param gen generator, must outlive the view
+	 * @param storage storage for chunks, not empty unless `size` is zero
+	 * @param size total number of bytes
+	 */
+	chunk_view(generator &gen, std::span<std::byte> storage, std::uint64_t size)
+		: gen_(&gen), storage_(storage), remaining_(size)
+	{
+		if (storage.empty() && size != 0) {
+			throw std::invalid_argument("lzdg: chunk storage must not be empty");
+		}
+	}
+
+	/**
+	 * Generate the first chunk and get iterator to it.
+	 *
+	 * @note This is a single-pass view, call only once.
+	 */
+	iterator begin() noexcept
+	{
+		advance();
+
+		return iterator(this);
+	}
+
+	std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+	void advance() noexcept
+	{
+		std::size_t num = remaining_ < storage_.size()
+		                ? static_cast<std::size_t>(remaining_)
+		                : storage_.size();
+
+		std::span<std::byte> chunk = storage_.first(num);
+
+		gen_->fill(chunk);
+
+		current_ = chunk;
+		remaining_ -= num;
+	}
+
+	generator *gen_;
+	std::span<std::byte> storage_;
+	std::uint64_t remaining_;
+	std::span<const std::byte> current_;
+};
+
+inline chunk_view
+generator::chunks(std::span<std::byte> storage, std::uint64_t size)
+{
+	return chunk_view(*this, storage, size);
+}
+
+/**
+ * Stream buffer serving generated data, for use with `std::istream`.
+ *
+ * Data is generated into an internal buffer, one block of the generator's
+ * stream at a time, so the data is the same as filling with blocks of
+ * `buffer_size` bytes. Reads of whole blocks with `read` or `sgetn` are
+ * generated directly into the caller's memory.
+ *
+ *     lzdg::istreambuf sb(lzdg::generator(seed), size);
+ *     std::istream in(&sb);
+ */
+class istreambuf : public std::streambuf {
+public:
+	/** Size for a stream without end. */
+	static constexpr std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+
+	/** Default size of internal buffer, the block size of `lzdgen --jobs`. */
+	static constexpr std::size_t default_buffer_size = 1024 * 1024;
+
+	/**
+	 * Construct stream buffer serving `size` bytes from `gen`.
+	 *
+	 * @param gen generator
+	 * @param size total number of bytes, or `unlimited`
+	 * @param buffer_size size of internal buffer and of generated blocks
+	 */
+	explicit istreambuf(generator gen, std::uint64_t size = unlimited,
+	                    std::size_t buffer_size = default_buffer_size)
+		: gen_(gen), remaining_(size), buffer_(buffer_size)
+	{
+		if (buffer_size == 0) {
+			throw std::invalid_argument("lzdg: buffer size must not be zero");
+		}
+
+		setg(buffer_.data(), buffer_.data(), buffer_.data());
+	}
+
+	istreambuf(const istreambuf &) = delete;
+	istreambuf &operator=(const istreambuf &) = delete;
+
+protected:
+	int_type underflow() override
+	{
+		if (gptr() == egptr()) {
+			std::size_t num = next_block_size();
+
+			if (num == 0) {
+				return traits_type::eof();
+			}
+
+			fill_block(buffer_.data(), num);
+
+			setg(buffer_.data(), buffer_.data(), buffer_.data() + num);
+		}
+
+		return traits_type::to_int_type(*gptr());
+	}
+
+	std::streamsize xsgetn(char_type *s, std::streamsize n) override
+	{
+		std::streamsize total = 0;
+
+		while (n > 0) {
+			std::streamsize avail = egptr() - gptr();
+
+			if (avail > 0) {
+				std::streamsize num = std::min(avail, n);
+
+				std::memcpy(s, gptr(), static_cast<std::size_t>(num));
+				setg(eback(), gptr() + num, egptr());
+
+				s += num;
+				n -= num;
+				total += num;
+
+				continue;
+			}
+
+			std::size_t block = next_block_size();
+
+			if (block == 0) {
+				break;
+			}
+
+			if (static_cast<std::uint64_t>(n) >= block) {
+				/* Whole block, generate it directly in place */
+				fill_block(s, block);
+
+				s += block;
+				n -= static_cast<std::streamsize>(block);
+				total += static_cast<std::streamsize>(block);
+			}
+			else if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+				break;
+			}
+		}
+
+		return total;
+	}
+
+	std::streamsize showmanyc() override
+	{
+		/* Called when the buffer is empty, so only remaining bytes count */
+		if (remaining_ == 0) {
+			return -1;
+		}
+
+		return static_cast<std::streamsize>(
+			std::min<std::uint64_t>(remaining_, std::numeric_limits<std::streamsize>::max()));
+	}
+
+private:
+	/**
+	 * Get size of the next block, zero at the end of the stream.
+	 */
+	std::size_t next_block_size() const noexcept
+	{
+		return remaining_ < buffer_.size()
+		     ? static_cast<std::size_t>(remaining_)
+		     : buffer_.size();
+	}
+
+	/**
+	 * Generate the next block of `num` bytes at `p`.
+	 */
+	void fill_block(char *p, std::size_t num) noexcept
+	{
+		gen_.fill(std::as_writable_bytes(std::span(p, num)));
+
+		remaining_ -= num;
+	}
+
+	generator gen_;
+	std::uint64_t remaining_;
+	std::vector<char> buffer_;
+};
+
+} // namespace lzdg
+
+#endif /* LZDATAGEN_HPP_INCLUDED */
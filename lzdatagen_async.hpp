@@ -0,0 +1,262 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZDATAGEN_ASYNC_HPP_INCLUDED
+#define LZDATAGEN_ASYNC_HPP_INCLUDED
+
+/*
+ * Header-only C++20 coroutine interface to lzdatagen.
+ *
+ * `async_generator::next_chunk` returns an awaitable that generates the
+ * next block of a stream on a `worker_pool` thread, and resumes the
+ * awaiting coroutine there when it is done. Any number of streams can
+ * share a pool with a few threads, and no memory is allocated per chunk,
+ * since the queued work item is stored in the awaitable, which lives in
+ * the coroutine frame while it is suspended.
+ *
+ * Generation starts when the awaitable is awaited. Awaitables work with
+ * any coroutine type, so they compose with asynchronous writes:
+ *
+ *     for (;;) {
+ *         auto chunk = co_await agen.next_chunk(buf);
+ *         co_await async_write(fd, chunk);
+ *     }
+ *
+ * While the coroutine is suspended, the thread that ran it is free to
+ * serve other streams.
+ */
+
+#include "lzdatagen.hpp"
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace lzdg {
+
+/**
+ * Pool of worker threads running queued jobs.
+ *
+ * Jobs are linked into the queue through a pointer in the job itself, so
+ * submitting does not allocate. The destructor runs any queued jobs before
+ * joining the threads.
+ */
+class worker_pool {
+public:
+	/**
+	 * Work item for `submit`.
+	 */
+	class job {
+	public:
+		/** Called on a worker thread. */
+		virtual void run() noexcept = 0;
+
+	protected:
+		job() = default;
+		job(const job &) noexcept {}
+		job &operator=(const job &) noexcept { return *this; }
+		~job() = default;
+
+	private:
+		friend class worker_pool;
+
+		job *next_ = nullptr;
+	};
+
+	/**
+	 * Start `num_threads` worker threads.
+	 *
+	 * @param num_threads number of threads, 0 for one per hardware thread
+	 */
+	explicit worker_pool(unsigned int num_threads = 0)
+	{
+		if (num_threads == 0) {
+			num_threads = std::thread::hardware_concurrency();
+		}
+
+		if (num_threads == 0) {
+			num_threads = 1;
+		}
+
+		threads_.reserve(num_threads);
+
+		for (unsigned int i = 0; i < num_threads; ++i) {
+			threads_.emplace_back([this] { work(); });
+		}
+	}
+
+	worker_pool(const worker_pool &) = delete;
+	worker_pool &operator=(const worker_pool &) = delete;
+
+	~worker_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+
+		cv_.notify_all();
+
+		for (auto &t : threads_) {
+			t.join();
+		}
+	}
+
+	/**
+	 * Queue `j` to be run on a worker thread.
+	 *
+	 * @param j job, must stay valid until it has run
+	 */
+	void submit(job *j)
+	{
+		j->next_ = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			if (tail_ != nullptr) {
+				tail_->next_ = j;
+			}
+			else {
+				head_ = j;
+			}
+
+			tail_ = j;
+		}
+
+		cv_.notify_one();
+	}
+
+private:
+	void work()
+	{
+		for (;;) {
+			job *j;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+
+				cv_.wait(lock, [this] { return head_ != nullptr || stop_; });
+
+				if (head_ == nullptr) {
+					return;
+				}
+
+				j = head_;
+				head_ = j->next_;
+
+				if (head_ == nullptr) {
+					tail_ = nullptr;
+				}
+			}
+
+			j->run();
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	job *head_ = nullptr;
+	job *tail_ = nullptr;
+	bool stop_ = false;
+	std::vector<std::thread> threads_;
+};
+
+/**
+ * Awaitable generating one block into caller storage on a worker pool.
+ *
+ * The result of `co_await` is a `std::span<const std::byte>` of the storage.
+ */
+class chunk_awaiter : private worker_pool::job {
+public:
+	chunk_awaiter(worker_pool &pool, const generator &gen, std::span<std::byte> out) noexcept
+		: pool_(&pool), gen_(gen), out_(out) {}
+
+	bool await_ready() const noexcept { return out_.empty(); }
+
+	void await_suspend(std::coroutine_handle<> h)
+	{
+		handle_ = h;
+
+		pool_->submit(this);
+	}
+
+	std::span<const std::byte> await_resume() const noexcept { return out_; }
+
+private:
+	void run() noexcept override
+	{
+		gen_.fill(out_);
+
+		handle_.resume();
+	}
+
+	worker_pool *pool_;
+	generator gen_;
+	std::span<std::byte> out_;
+	std::coroutine_handle<> handle_;
+};
+
+/**
+ * Generator of a stream of compressible data, generating on a worker pool.
+ *
+ * Each call to `next_chunk` takes the next block index of the stream, so
+ * the data is the same as filling a `generator` with the same sizes in the
+ * same order, even if several chunks are awaited at once.
+ */
+class async_generator {
+public:
+	/**
+	 * Construct from `gen`, generating on `pool`.
+	 *
+	 * @param pool worker pool, must outlive any awaitables
+	 * @param gen generator for stream
+	 */
+	async_generator(worker_pool &pool, const generator &gen) noexcept
+		: pool_(&pool), gen_(gen) {}
+
+	/**
+	 * Get awaitable that fills `out` with the next block of the stream.
+	 *
+	 * @param out storage to fill, must stay valid until awaited
+	 */
+	chunk_awaiter next_chunk(std::span<std::byte> out) noexcept
+	{
+		chunk_awaiter a(*pool_, gen_, out);
+
+		if (!out.empty()) {
+			gen_.seek(gen_.block_index() + 1);
+		}
+
+		return a;
+	}
+
+private:
+	worker_pool *pool_;
+	generator gen_;
+};
+
+} // namespace lzdg
+
+#endif /* LZDATAGEN_ASYNC_HPP_INCLUDED */
@@ -0,0 +1,136 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "lzdg_cli.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+unsigned long long
+lzdg_strtosize(const char *s, char **endptr, int base)
+{
+	char *ep = NULL;
+	unsigned long long v;
+	int power = 0;
+	int orig_errno = errno;
+
+	errno = 0;
+
+	v = strtoull(s, &ep, base);
+
+	if (errno == 0) {
+		errno = orig_errno;
+	}
+
+	if (ep == s) {
+		goto done;
+	}
+
+	switch (*ep) {
+	case 'k':
+	case 'K':
+		power = 1;
+		++ep;
+		break;
+	case 'm':
+	case 'M':
+		power = 2;
+		++ep;
+		break;
+	case 'g':
+	case 'G':
+		power = 3;
+		++ep;
+		break;
+	case 't':
+	case 'T':
+		power = 4;
+		++ep;
+		break;
+	default:
+		break;
+	}
+
+	while (power--) {
+		if (v > ULLONG_MAX / 1024ULL) {
+			errno = ERANGE;
+			v = ULLONG_MAX;
+			break;
+		}
+
+		v *= 1024ULL;
+	}
+
+done:
+	if (endptr != NULL) {
+		*endptr = ep;
+	}
+
+	return v;
+}
+
+int
+lzdg_valid_exp(double exp)
+{
+	/* Comparisons are false for NaN */
+	return exp > 0.0 && exp < HUGE_VAL;
+}
+
+int
+lzdg_valid_ratio(double ratio)
+{
+	/* Comparisons are false for NaN */
+	return ratio >= 1.0 && ratio < HUGE_VAL;
+}
+
+int
+lzdg_parse_list(const char *s, double *values, int max)
+{
+	int num = 0;
+
+	for (;;) {
+		char *ep = NULL;
+		double v;
+
+		if (num == max) {
+			return -1;
+		}
+
+		errno = 0;
+
+		v = strtod(s, &ep);
+
+		if (ep == s || errno == ERANGE || (*ep != ',' && *ep != '\0')) {
+			return -1;
+		}
+
+		values[num++] = v;
+
+		if (*ep == '\0') {
+			break;
+		}
+
+		s = ep + 1;
+	}
+
+	return num;
+}
@@ -0,0 +1,72 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Argument parsing shared by the command line tools, not part of the
+ * library.
+ */
+
+#ifndef LZDG_CLI_H_INCLUDED
+#define LZDG_CLI_H_INCLUDED
+
+/**
+ * Wrapper around strtoull to parse size suffixes.
+ *
+ * Accepts the suffixes `k`, `m`, `g` and `t` (in either case) for powers of
+ * 1024. On overflow, `errno` is set to `ERANGE`.
+ *
+ * @param s string to parse
+ * @param endptr pointer to first character not parsed, or `NULL`
+ * @param base base passed to strtoull
+ * @return parsed value
+ */
+unsigned long long
+lzdg_strtosize(const char *s, char **endptr, int base);
+
+/**
+ * Check if `exp` is a valid distribution exponent.
+ *
+ * @param exp exponent
+ * @return non-zero if `exp` is finite and greater than zero
+ */
+int
+lzdg_valid_exp(double exp);
+
+/**
+ * Check if `ratio` is a valid compression ratio.
+ *
+ * @param ratio ratio
+ * @return non-zero if `ratio` is finite and at least 1.0
+ */
+int
+lzdg_valid_ratio(double ratio);
+
+/**
+ * Parse comma separated list of floating point values from `s`.
+ *
+ * @param s string to parse
+ * @param values pointer to where to store values
+ * @param max maximum number of values
+ * @return number of values, or -1 on error or if there are more than `max`
+ */
+int
+lzdg_parse_list(const char *s, double *values, int max);
+
+#endif /* LZDG_CLI_H_INCLUDED */
@@ -0,0 +1,352 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Float model.
+ *
+ * Time series of little-endian IEEE 754 values, like telemetry, as the sum
+ * of a mean-reverting random walk, a seasonal cycle and noise, with
+ * optional truncation of the mantissa and repeated values. Samples are
+ * generated a segment at a time for each series, and written either one
+ * series after the other, or interleaved into rows.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of samples of each series in a segment */
+#define FLOAT_SEGMENT 256
+
+/* Maximum number of series */
+#define FLOAT_MAX_SERIES 16
+
+/* Maximum number of samples in a seasonal cycle */
+#define FLOAT_MAX_PERIOD 65536
+
+#define FLOAT_PI 3.14159265358979323846
+
+enum float_layout {
+	LAYOUT_COLUMN,
+	LAYOUT_ROW
+};
+
+struct float_params {
+	uint64_t width;
+	uint64_t series;
+	unsigned int layout;
+	double level;
+	double walk;
+	double revert;
+	double season;
+	uint64_t period;
+	double noise;
+	uint64_t mantissa;
+	double repeat;
+};
+
+static const struct lzdg_option float_options[] = {
+	{ "width", LZDG_OPT_UINT, offsetof(struct float_params, width), 32, 64, NULL,
+	  "float width must be 32 or 64" },
+	{ "series", LZDG_OPT_UINT, offsetof(struct float_params, series), 1, FLOAT_MAX_SERIES, NULL,
+	  "float series must be 1 to 16" },
+	{ "layout", LZDG_OPT_ENUM, offsetof(struct float_params, layout), 0, 0, "column,row",
+	  "float layout must be column or row" },
+	{ "level", LZDG_OPT_DOUBLE, offsetof(struct float_params, level), -1e30, 1e30, NULL,
+	  "float level must be -1e30 to 1e30" },
+	{ "walk", LZDG_OPT_DOUBLE, offsetof(struct float_params, walk), 0, 1e30, NULL,
+	  "float walk must be 0 to 1e30" },
+	{ "revert", LZDG_OPT_DOUBLE, offsetof(struct float_params, revert), 0, 1, NULL,
+	  "float revert must be 0.0 to 1.0" },
+	{ "season", LZDG_OPT_DOUBLE, offsetof(struct float_params, season), 0, 1e30, NULL,
+	  "float season must be 0 to 1e30" },
+	{ "period", LZDG_OPT_UINT, offsetof(struct float_params, period), 2, FLOAT_MAX_PERIOD, NULL,
+	  "float period must be 2 to 65536" },
+	{ "noise", LZDG_OPT_DOUBLE, offsetof(struct float_params, noise), 0, 1e30, NULL,
+	  "float noise must be 0 to 1e30" },
+	{ "mantissa", LZDG_OPT_UINT, offsetof(struct float_params, mantissa), 0, 52, NULL,
+	  "float mantissa must be 0 to 52 bits" },
+	{ "repeat", LZDG_OPT_DOUBLE, offsetof(struct float_params, repeat), 0, 1, NULL,
+	  "float repeat must be 0.0 to 1.0" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+struct float_series {
+	double level;
+	double amplitude;
+	uint32_t phase;
+};
+
+struct float_model {
+	struct float_params params;
+	struct float_series series[FLOAT_MAX_SERIES];
+	double *cycle;          /**< One period of the seasonal cycle */
+	double walk_dev;        /**< Standard deviation of walk, or 0 if unbounded */
+	uint64_t mantissa_mask; /**< Mask of kept bits of values */
+	uint32_t repeat;
+	unsigned int bytes;
+	size_t segment_size;    /**< Bytes in a segment of all series */
+	uint64_t seed;
+};
+
+/*
+ * Approximately normal value with mean 0 and standard deviation 1, from
+ * the sum of four uniform 16-bit values.
+ */
+static double
+normal(struct rng_state *rng)
+{
+	uint64_t r = rng_next64(rng);
+	uint32_t sum = (uint32_t) (r & 0xFFFF) + (uint32_t) ((r >> 16) & 0xFFFF)
+	             + (uint32_t) ((r >> 32) & 0xFFFF) + (uint32_t) (r >> 48);
+
+	/* Sum has mean 2 and variance 1/3 in units of 65536 */
+	return ((double) sum / 65536.0 - 2.0) * 1.7320508075688772;
+}
+
+static void
+float_destroy(void *state)
+{
+	struct float_model *m = (struct float_model *) state;
+
+	if (m == NULL) {
+		return;
+	}
+
+	free(m->cycle);
+	free(m);
+}
+
+static void *
+float_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct float_params params = {
+		64, 1, LAYOUT_COLUMN, 100.0, 0.1, 0.001, 10.0, 1440, 0.5, 0, 0.0
+	};
+	struct float_model *m;
+	struct rng_state rng;
+	unsigned int mantissa_bits;
+	size_t i;
+
+	if (lzdg_parse_options(float_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	if (params.width != 32 && params.width != 64) {
+		*error = "float width must be 32 or 64";
+		return NULL;
+	}
+
+	mantissa_bits = params.width == 32 ? 23 : 52;
+
+	if (params.mantissa > mantissa_bits) {
+		*error = "float mantissa must be at most 23 bits for width 32";
+		return NULL;
+	}
+
+	m = (struct float_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->params = params;
+	m->seed = seed;
+	m->bytes = (unsigned int) (params.width / 8);
+	m->segment_size = FLOAT_SEGMENT * params.series * m->bytes;
+	m->repeat = params.repeat >= 1.0 ? UINT32_MAX : (uint32_t) (params.repeat * 4294967296.0);
+
+	/* Clear the low mantissa bits that are not kept */
+	m->mantissa_mask = UINT64_MAX;
+
+	if (params.mantissa != 0) {
+		m->mantissa_mask <<= mantissa_bits - params.mantissa;
+	}
+
+	/*
+	 * The walk of each block starts from its stationary distribution,
+	 * since it can not continue from the previous block. Without
+	 * reversion, it starts from zero.
+	 */
+	if (params.revert > 0.0) {
+		m->walk_dev = params.walk / sqrt(params.revert * (2.0 - params.revert));
+	}
+
+	m->cycle = (double *) malloc(params.period * sizeof(m->cycle[0]));
+
+	if (m->cycle == NULL) {
+		float_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	for (i = 0; i < params.period; ++i) {
+		m->cycle[i] = sin(2.0 * FLOAT_PI * (double) i / (double) params.period);
+	}
+
+	/* Series differ in level, amplitude and phase */
+	rng_seed(&rng, seed ^ UINT64_C(0x9E3779B97F4A7C15));
+
+	for (i = 0; i < params.series; ++i) {
+		m->series[i].level = params.level * (0.5 + rand_double(&rng));
+		m->series[i].amplitude = params.season * (0.5 + rand_double(&rng));
+		m->series[i].phase = (uint32_t) (rand_double(&rng) * (double) params.period);
+	}
+
+	return m;
+}
+
+/*
+ * Generate `FLOAT_SEGMENT` samples of series `s` starting at time `t`,
+ * continuing the walk at `walk`.
+ */
+static void
+fill_series(const struct float_model *m, struct rng_state *rng, size_t s, uint64_t t,
+            double *walk, double *v)
+{
+	const struct float_series *fs = &m->series[s];
+	double keep = 1.0 - m->params.revert;
+	double x = *walk;
+	size_t phase = (size_t) ((t + fs->phase) % m->params.period);
+	size_t i;
+
+	for (i = 0; i < FLOAT_SEGMENT; ++i) {
+		x = x * keep + m->params.walk * normal(rng);
+
+		v[i] = fs->level + x + fs->amplitude * m->cycle[phase]
+		     + m->params.noise * normal(rng);
+
+		if (++phase == m->params.period) {
+			phase = 0;
+		}
+	}
+
+	*walk = x;
+}
+
+/* Write sample `v` to `p`, truncating the mantissa */
+static unsigned char *
+put_sample(const struct float_model *m, double v, unsigned char *p)
+{
+	if (m->bytes == 4) {
+		float f = (float) v;
+		uint32_t bits;
+
+		memcpy(&bits, &f, sizeof(bits));
+
+		return lzdg_put_le(p, bits & (uint32_t) m->mantissa_mask, 4);
+	}
+	else {
+		uint64_t bits;
+
+		memcpy(&bits, &v, sizeof(bits));
+
+		return lzdg_put_le(p, bits & m->mantissa_mask, 8);
+	}
+}
+
+static void
+float_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct float_model *m = (const struct float_model *) state;
+	double v[FLOAT_MAX_SERIES][FLOAT_SEGMENT];
+	unsigned char seg[FLOAT_MAX_SERIES * FLOAT_SEGMENT * 8];
+	double walk[FLOAT_MAX_SERIES];
+	double prev[FLOAT_MAX_SERIES];
+	size_t num_series = (size_t) m->params.series;
+	uint64_t offs = index * LZDG_NOMINAL_BLOCK;
+	uint64_t segment = offs / m->segment_size;
+	size_t skip = (size_t) (offs % m->segment_size);
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	struct rng_state rng;
+	int first = 1;
+	size_t s;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	for (s = 0; s < num_series; ++s) {
+		walk[s] = m->walk_dev * normal(&rng);
+		prev[s] = 0.0;
+	}
+
+	while (p < end) {
+		unsigned char *q = seg;
+		size_t len;
+		size_t i;
+
+		for (s = 0; s < num_series; ++s) {
+			fill_series(m, &rng, s, segment * FLOAT_SEGMENT, &walk[s], v[s]);
+
+			/* Repeated values continue across segments */
+			if (m->repeat != 0) {
+				for (i = first; i < FLOAT_SEGMENT; ++i) {
+					if (rng_next32(&rng) < m->repeat) {
+						v[s][i] = i ? v[s][i - 1] : prev[s];
+					}
+				}
+
+				prev[s] = v[s][FLOAT_SEGMENT - 1];
+			}
+		}
+
+		if (m->params.layout == LAYOUT_COLUMN) {
+			for (s = 0; s < num_series; ++s) {
+				for (i = 0; i < FLOAT_SEGMENT; ++i) {
+					q = put_sample(m, v[s][i], q);
+				}
+			}
+		}
+		else {
+			for (i = 0; i < FLOAT_SEGMENT; ++i) {
+				for (s = 0; s < num_series; ++s) {
+					q = put_sample(m, v[s][i], q);
+				}
+			}
+		}
+
+		len = m->segment_size - skip;
+
+		if (len > (size_t) (end - p)) {
+			len = (size_t) (end - p);
+		}
+
+		memcpy(p, seg + skip, len);
+		p += len;
+
+		skip = 0;
+		first = 0;
+		segment++;
+	}
+}
+
+const struct lzdg_model_type lzdg_float_model = {
+	"float",
+	"time series of floats from walk, seasonal and noise components",
+	float_create,
+	float_generate,
+	float_destroy
+};
@@ -0,0 +1,359 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Integer model.
+ *
+ * Arrays of little-endian integers, with the value ranges, sortedness, runs
+ * and outliers that integer codecs like frame of reference, delta coding
+ * and bit-packing are sensitive to. Values are generated a segment at a
+ * time, in passes that each apply one property, so the loops are simple
+ * enough for the compiler to vectorize.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of values in a segment, which is either sorted or not */
+#define INT_SEGMENT 1024
+
+/* Number of values in table of deltas, as a power of 2 */
+#define INT_DELTA_BITS 12
+#define INT_DELTA_SIZE (1U << INT_DELTA_BITS)
+
+enum int_dist {
+	DIST_UNIFORM,
+	DIST_NORMAL,
+	DIST_LOG
+};
+
+struct int_params {
+	uint64_t width;
+	uint64_t bits;
+	unsigned int dist;
+	double delta;
+	double run;
+	double sorted;
+	double outliers;
+};
+
+static const struct lzdg_option int_options[] = {
+	{ "width", LZDG_OPT_UINT, offsetof(struct int_params, width), 8, 64, NULL,
+	  "int width must be 8, 16, 32 or 64" },
+	{ "bits", LZDG_OPT_UINT, offsetof(struct int_params, bits), 0, 64, NULL,
+	  "int bits must be 0 to 64" },
+	{ "dist", LZDG_OPT_ENUM, offsetof(struct int_params, dist), 0, 0, "uniform,normal,log",
+	  "int dist must be uniform, normal or log" },
+	{ "delta", LZDG_OPT_DOUBLE, offsetof(struct int_params, delta), 0, 1e15, NULL,
+	  "int delta must be 0 to 1e15" },
+	{ "run", LZDG_OPT_DOUBLE, offsetof(struct int_params, run), 1, 1e9, NULL,
+	  "int run must be 1 to 1e9" },
+	{ "sorted", LZDG_OPT_DOUBLE, offsetof(struct int_params, sorted), 0, 1, NULL,
+	  "int sorted must be 0.0 to 1.0" },
+	{ "outliers", LZDG_OPT_DOUBLE, offsetof(struct int_params, outliers), 0, 1, NULL,
+	  "int outliers must be 0.0 to 1.0" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+struct int_model {
+	struct int_params params;
+	uint64_t mask;       /**< Mask of `bits` low bits */
+	uint64_t width_mask; /**< Mask of `width` low bits */
+	uint64_t start_max;  /**< Largest start of sorted segments */
+	double start_scale;  /**< Scale of base values to starts */
+	uint32_t sorted;     /**< Probabilities scaled to 2^32 */
+	uint32_t repeat;
+	uint32_t outlier;
+	unsigned int bytes;
+	uint64_t delta_table[INT_DELTA_SIZE + 1];
+	uint64_t seed;
+};
+
+static uint32_t
+probability(double p)
+{
+	return p >= 1.0 ? UINT32_MAX : (uint32_t) (p * 4294967296.0);
+}
+
+static void
+int_destroy(void *state)
+{
+	free(state);
+}
+
+static void *
+int_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct int_params params = { 32, 0, DIST_UNIFORM, 16.0, 1.0, 0.0, 0.0 };
+	struct int_model *m;
+	double span;
+	size_t i;
+
+	if (lzdg_parse_options(int_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	if (params.width != 8 && params.width != 16 && params.width != 32 && params.width != 64) {
+		*error = "int width must be 8, 16, 32 or 64";
+		return NULL;
+	}
+
+	/* Values use half the width by default */
+	if (params.bits == 0) {
+		params.bits = params.width / 2;
+	}
+
+	if (params.bits > params.width) {
+		*error = "int bits must be at most width";
+		return NULL;
+	}
+
+	m = (struct int_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->params = params;
+	m->seed = seed;
+	m->bytes = (unsigned int) (params.width / 8);
+	m->mask = UINT64_MAX >> (64 - params.bits);
+	m->width_mask = UINT64_MAX >> (64 - params.width);
+	m->sorted = probability(params.sorted);
+	m->repeat = probability(1.0 - 1.0 / params.run);
+	m->outlier = probability(params.outliers);
+
+	/*
+	 * Quantiles of the exponential distribution of deltas. Values between
+	 * two entries are interpolated, so deltas are not limited to the
+	 * entries of the table.
+	 */
+	for (i = 0; i < INT_DELTA_SIZE; ++i) {
+		m->delta_table[i] = (uint64_t) (-params.delta * log(1.0 - (double) i / INT_DELTA_SIZE));
+	}
+
+	m->delta_table[INT_DELTA_SIZE] = (uint64_t) (params.delta * (INT_DELTA_BITS + 1) * 0.6931471805599453);
+
+	/*
+	 * Sorted segments start low enough that the expected sum of their
+	 * deltas fits in `bits`, by scaling a value from the base distribution.
+	 */
+	span = params.delta * INT_SEGMENT;
+
+	if (span < (double) m->mask) {
+		m->start_max = m->mask - (uint64_t) span;
+		m->start_scale = (double) m->start_max / (double) m->mask;
+	}
+
+	return m;
+}
+
+/* Fill `v` with `n` values from the base distribution */
+static void
+sample_base(const struct int_model *m, struct rng_state *rng, uint64_t *v, size_t n)
+{
+	unsigned int bits = (unsigned int) m->params.bits;
+	size_t i;
+
+	switch (m->params.dist) {
+	case DIST_UNIFORM:
+		for (i = 0; i < n; ++i) {
+			v[i] = rng_next64(rng) >> (64 - bits);
+		}
+		break;
+	case DIST_NORMAL:
+		/* Sum of four uniform values, which is close to normal */
+		if (bits < 3) {
+			for (i = 0; i < n; ++i) {
+				v[i] = rng_next64(rng) >> (64 - bits);
+			}
+			break;
+		}
+
+		for (i = 0; i < n; ++i) {
+			uint64_t a = rng_next64(rng);
+			uint64_t b = rng_next64(rng);
+			unsigned int shift = 66 - bits;
+
+			v[i] = (a >> shift) + ((a << 32) >> shift)
+			     + (b >> shift) + ((b << 32) >> shift);
+		}
+		break;
+	case DIST_LOG:
+		/* Octave uniformly distributed, then uniform within the octave */
+		for (i = 0; i < n; ++i) {
+			uint64_t r = rng_next64(rng);
+			unsigned int k = (unsigned int) (((r & 0xFFFF) * bits) >> 16);
+			uint64_t low = k ? (r >> (64 - k)) : 0;
+
+			v[i] = ((UINT64_C(1) << k) - 1) + low;
+		}
+		break;
+	}
+}
+
+/*
+ * Fill `v` with a segment of `n` values. `prev` points to the last value of
+ * the previous segment, for runs that cross segments, or is `NULL` for the
+ * first segment of a block.
+ */
+static void
+fill_segment(const struct int_model *m, struct rng_state *rng, uint64_t *v, size_t n,
+             const uint64_t *prev)
+{
+	int sorted = rng_next32(rng) < m->sorted;
+	size_t i;
+
+	if (sorted) {
+		uint64_t x = 0;
+
+		sample_base(m, rng, &x, 1);
+
+		if (m->start_max < m->mask) {
+			double y = (double) x * m->start_scale;
+
+			x = y < (double) m->start_max ? (uint64_t) y : m->start_max;
+		}
+
+		/* Sum saturates at the largest value, so the segment stays sorted */
+		for (i = 0; i < n; ++i) {
+			uint64_t r = rng_next64(rng);
+			uint64_t lo = m->delta_table[r >> (64 - INT_DELTA_BITS)];
+			uint64_t hi = m->delta_table[(r >> (64 - INT_DELTA_BITS)) + 1];
+			uint64_t d = lo + (((hi - lo) * (r & 0xFFFF)) >> 16);
+
+			x = d > m->mask - x ? m->mask : x + d;
+			v[i] = x;
+		}
+	}
+	else {
+		sample_base(m, rng, v, n);
+	}
+
+	if (m->repeat != 0) {
+		/* Runs only continue into unsorted segments, to keep them sorted */
+		if (prev != NULL && rng_next32(rng) < m->repeat && !sorted) {
+			v[0] = *prev;
+		}
+
+		for (i = 1; i < n; ++i) {
+			if (rng_next32(rng) < m->repeat) {
+				v[i] = v[i - 1];
+			}
+		}
+	}
+
+	if (m->outlier != 0) {
+		for (i = 0; i < n; ++i) {
+			uint64_t r = rng_next64(rng);
+
+			if ((uint32_t) r < m->outlier) {
+				v[i] = rng_next64(rng) & m->width_mask;
+			}
+		}
+	}
+}
+
+static unsigned char *
+store_values(const struct int_model *m, const uint64_t *v, size_t n, unsigned char *p)
+{
+	size_t i;
+
+	switch (m->bytes) {
+	case 1:
+		for (i = 0; i < n; ++i) {
+			p[i] = (unsigned char) v[i];
+		}
+		break;
+	case 2:
+		for (i = 0; i < n; ++i) {
+			lzdg_put_le(p + 2 * i, v[i], 2);
+		}
+		break;
+	case 4:
+		for (i = 0; i < n; ++i) {
+			lzdg_put_le(p + 4 * i, v[i], 4);
+		}
+		break;
+	default:
+		for (i = 0; i < n; ++i) {
+			lzdg_put_le(p + 8 * i, v[i], 8);
+		}
+		break;
+	}
+
+	return p + n * m->bytes;
+}
+
+static void
+int_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct int_model *m = (const struct int_model *) state;
+	uint64_t v[INT_SEGMENT];
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	struct rng_state rng;
+	uint64_t prev = 0;
+	int first = 1;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	while (p < end) {
+		size_t left = (size_t) (end - p);
+		size_t n = INT_SEGMENT;
+
+		/* Last segment is cut to the values that fit, plus a partial one */
+		if (left < n * m->bytes) {
+			n = (left + m->bytes - 1) / m->bytes;
+		}
+
+		fill_segment(m, &rng, v, n, first ? NULL : &prev);
+
+		prev = v[n - 1];
+		first = 0;
+
+		if (left >= n * m->bytes) {
+			p = store_values(m, v, n, p);
+		}
+		else {
+			unsigned char tmp[8];
+
+			p = store_values(m, v, n - 1, p);
+			store_values(m, v + n - 1, 1, tmp);
+			memcpy(p, tmp, (size_t) (end - p));
+			p = end;
+		}
+	}
+}
+
+const struct lzdg_model_type lzdg_int_model = {
+	"int",
+	"integers with ranges, deltas, runs and outliers",
+	int_create,
+	int_generate,
+	int_destroy
+};
@@ -0,0 +1,863 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Internal definitions shared by the source files of the library, not part
+ * of the public interface.
+ */
+
+#ifndef LZDG_INTERNAL_H_INCLUDED
+#define LZDG_INTERNAL_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * On x86-64 with GCC or Clang and glibc, the generation functions are
+ * compiled for several ISA levels, and the best one for the CPU is selected
+ * when the library is loaded (using an ifunc resolver). This allows building
+ * without -march=native while still using AVX2 or AVX-512 where available.
+ * Define LZDG_NO_TARGET_CLONES to disable.
+ */
+#if !defined(LZDG_NO_TARGET_CLONES) && defined(__x86_64__) && defined(__ELF__) \
+ && defined(__GLIBC__) && defined(__has_attribute)
+#  if __has_attribute(target_clones)
+#    define LZDG_TARGET_CLONES __attribute__((target_clones("default", "sse4.1", "avx2", "avx512f")))
+#  endif
+#endif
+
+#if !defined(LZDG_TARGET_CLONES)
+#  define LZDG_TARGET_CLONES
+#endif
+
+/*
+ * Force inlining of the generic kernels into their specializations, so
+ * constant arguments remove the code they do not need.
+ */
+#if defined(__GNUC__)
+#  define LZDG_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#  define LZDG_ALWAYS_INLINE __forceinline
+#else
+#  define LZDG_ALWAYS_INLINE inline
+#endif
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/*
+ * PRNG backend, selected at compile time by defining one of:
+ *
+ *   LZDG_RNG_PCG64DXSM    PCG 128-bit LCG with DXSM output
+ *   LZDG_RNG_XOSHIRO256PP xoshiro256++
+ *   LZDG_RNG_WYRAND       wyrand
+ *   LZDG_RNG_PHILOX       Philox4x32-10 counter-based generator
+ *
+ * The default is pcg32 (PCG-XSH-RR), which produces the same output as
+ * pcg32_srandom(seed, 0xC0FFEE) from pcg_basic did.
+ *
+ * Each backend provides `struct rng_state`, `RNG_INITIALIZER`, `rng_seed()`,
+ * `rng_seed_block()`, `rng_next32()` and `rng_next64()`. The generation
+ * functions work on a local copy of the state, so it can be kept in
+ * registers.
+ *
+ * `rng_seed_block()` sets up the state for block `index` of the stream
+ * given by `seed`, for `lzdg_generate_block` and the models. For the sequential generators
+ * the seed is mixed with the index, while for Philox each value is a
+ * function of the key and a counter, so the key is the seed and the index
+ * is placed in the upper half of the counter.
+ */
+#if defined(LZDG_RNG_PCG64DXSM) || defined(LZDG_RNG_WYRAND)
+#  if !defined(__SIZEOF_INT128__)
+#    error "selected PRNG backend requires unsigned __int128"
+#  endif
+#endif
+
+static inline uint64_t
+splitmix64(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+#if defined(LZDG_RNG_PHILOX)
+
+#define RNG_NAME "philox4x32"
+
+struct rng_state {
+	uint32_t ctr[4];
+	uint32_t key[2];
+	uint32_t out[4];
+	unsigned int pos;
+};
+
+#define RNG_INITIALIZER { { 0, 0, 0, 0 }, { 0, 0 }, { 0, 0, 0, 0 }, 4 }
+
+/* Compute the 10 rounds of Philox4x32 on the counter into `out` */
+static inline void
+philox4x32_10(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+{
+	uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	uint32_t k0 = key[0], k1 = key[1];
+	int i;
+
+	for (i = 0; i < 10; ++i) {
+		uint64_t p0 = (uint64_t) 0xD2511F53U * c0;
+		uint64_t p1 = (uint64_t) 0xCD9E8D57U * c2;
+
+		c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t) p1;
+		c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t) p0;
+
+		k0 += 0x9E3779B9U;
+		k1 += 0xBB67AE85U;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+static inline uint32_t
+rng_next32(struct rng_state *rng)
+{
+	if (rng->pos == 4) {
+		philox4x32_10(rng->ctr, rng->key, rng->out);
+
+		/* Increment lower 64 bits of counter */
+		if (++rng->ctr[0] == 0) {
+			rng->ctr[1]++;
+		}
+
+		rng->pos = 0;
+	}
+
+	return rng->out[rng->pos++];
+}
+
+static inline uint64_t
+rng_next64(struct rng_state *rng)
+{
+	uint64_t hi = rng_next32(rng);
+
+	return (hi << 32) | rng_next32(rng);
+}
+
+static inline void
+rng_seed_block(struct rng_state *rng, uint64_t seed, uint64_t index)
+{
+	rng->key[0] = (uint32_t) seed;
+	rng->key[1] = (uint32_t) (seed >> 32);
+	rng->ctr[0] = 0;
+	rng->ctr[1] = 0;
+	rng->ctr[2] = (uint32_t) index;
+	rng->ctr[3] = (uint32_t) (index >> 32);
+	rng->pos = 4;
+}
+
+static inline void
+rng_seed(struct rng_state *rng, uint64_t seed)
+{
+	rng_seed_block(rng, seed, 0);
+}
+
+#elif defined(LZDG_RNG_PCG64DXSM)
+
+#define RNG_NAME "pcg64dxsm"
+
+struct rng_state {
+	unsigned __int128 state;
+	unsigned __int128 inc;
+};
+
+#define RNG_INITIALIZER { 0, 1 }
+
+static inline uint64_t
+rng_next64(struct rng_state *rng)
+{
+	uint64_t hi = (uint64_t) (rng->state >> 64);
+	uint64_t lo = (uint64_t) rng->state | 1;
+
+	hi ^= hi >> 32;
+	hi *= 0xDA942042E4DD58B5ULL;
+	hi ^= hi >> 48;
+	hi *= lo;
+
+	rng->state = rng->state * 0xDA942042E4DD58B5ULL + rng->inc;
+
+	return hi;
+}
+
+static inline uint32_t
+rng_next32(struct rng_state *rng)
+{
+	return (uint32_t) (rng_next64(rng) >> 32);
+}
+
+static inline void
+rng_seed(struct rng_state *rng, uint64_t seed)
+{
+	uint64_t x = seed;
+
+	rng->state = 0;
+	rng->inc = ((unsigned __int128) 0xC0FFEE << 1) | 1;
+	rng_next64(rng);
+	rng->state += ((unsigned __int128) splitmix64(&x) << 64) | splitmix64(&x);
+	rng_next64(rng);
+}
+
+#elif defined(LZDG_RNG_XOSHIRO256PP)
+
+#define RNG_NAME "xoshiro256++"
+
+struct rng_state {
+	uint64_t s[4];
+};
+
+#define RNG_INITIALIZER { { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, \
+                            0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL } }
+
+static inline uint64_t
+rotl64(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t
+rng_next64(struct rng_state *rng)
+{
+	uint64_t *s = rng->s;
+	uint64_t res = rotl64(s[0] + s[3], 23) + s[0];
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl64(s[3], 45);
+
+	return res;
+}
+
+static inline uint32_t
+rng_next32(struct rng_state *rng)
+{
+	return (uint32_t) (rng_next64(rng) >> 32);
+}
+
+static inline void
+rng_seed(struct rng_state *rng, uint64_t seed)
+{
+	uint64_t x = seed;
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		rng->s[i] = splitmix64(&x);
+	}
+}
+
+#elif defined(LZDG_RNG_WYRAND)
+
+#define RNG_NAME "wyrand"
+
+struct rng_state {
+	uint64_t state;
+};
+
+#define RNG_INITIALIZER { 0 }
+
+static inline uint64_t
+rng_next64(struct rng_state *rng)
+{
+	unsigned __int128 t;
+
+	rng->state += 0xA0761D6478BD642FULL;
+
+	t = (unsigned __int128) rng->state * (rng->state ^ 0xE7037ED1A0B428DBULL);
+
+	return (uint64_t) (t >> 64) ^ (uint64_t) t;
+}
+
+static inline uint32_t
+rng_next32(struct rng_state *rng)
+{
+	return (uint32_t) (rng_next64(rng) >> 32);
+}
+
+static inline void
+rng_seed(struct rng_state *rng, uint64_t seed)
+{
+	uint64_t x = seed;
+
+	rng->state = splitmix64(&x);
+}
+
+#else
+
+#define RNG_NAME "pcg32"
+
+struct rng_state {
+	uint64_t state;
+	uint64_t inc;
+};
+
+#define RNG_INITIALIZER { 0x853C49E6748FEA9BULL, 0xDA3E39CB94B95BDBULL }
+
+static inline uint32_t
+rng_next32(struct rng_state *rng)
+{
+	uint64_t oldstate = rng->state;
+	uint32_t xorshifted = (uint32_t) (((oldstate >> 18) ^ oldstate) >> 27);
+	uint32_t rot = (uint32_t) (oldstate >> 59);
+
+	rng->state = oldstate * 6364136223846793005ULL + rng->inc;
+
+	return (xorshifted >> rot) | (xorshifted << ((0U - rot) & 31));
+}
+
+static inline uint64_t
+rng_next64(struct rng_state *rng)
+{
+	uint64_t hi = rng_next32(rng);
+
+	return (hi << 32) | rng_next32(rng);
+}
+
+static inline void
+rng_seed(struct rng_state *rng, uint64_t seed)
+{
+	rng->state = 0;
+	rng->inc = (0xC0FFEEULL << 1) | 1;
+	rng_next32(rng);
+	rng->state += seed;
+	rng_next32(rng);
+}
+
+#endif
+
+#if !defined(LZDG_RNG_PHILOX)
+static inline void
+rng_seed_block(struct rng_state *rng, uint64_t seed, uint64_t index)
+{
+	uint64_t x = index;
+
+	rng_seed(rng, seed ^ splitmix64(&x));
+}
+#endif
+
+/**
+ * Generate random double.
+ *
+ * @note Not perfectly distributed, but more than adequate for this use.
+ *
+ * @return random double in range [0;1)
+ */
+static inline double
+rand_double(struct rng_state *rng)
+{
+	return rng_next32(rng) / (UINT32_MAX + 1.0);
+}
+
+/**
+ * Generate random integer in range [0;n).
+ */
+static inline uint32_t
+lzdg_uniform(struct rng_state *rng, uint32_t n)
+{
+	return (uint32_t) (((uint64_t) rng_next32(rng) * n) >> 32);
+}
+
+/**
+ * Reservoir of random bits.
+ *
+ * Bulk mode and the models only need a few random bits for each decision,
+ * so instead of using a full PRNG value for each, the bits of 64-bit values
+ * are handed out as needed.
+ */
+struct rng_bits {
+	uint64_t bits;
+	unsigned int avail;
+};
+
+/**
+ * Get `n` random bits from reservoir `res`, refilling it from `rng`.
+ *
+ * If less than `n` bits are left, they are discarded.
+ *
+ * @param n number of bits, 1 to 32
+ * @return random value in range [0;2^n)
+ */
+static inline uint32_t
+rng_take_bits(struct rng_state *rng, struct rng_bits *res, unsigned int n)
+{
+	uint32_t v;
+
+	if (res->avail < n) {
+		res->bits = rng_next64(rng);
+		res->avail = 64;
+	}
+
+	v = (uint32_t) (res->bits & ((UINT64_C(1) << n) - 1));
+
+	res->bits >>= n;
+	res->avail -= n;
+
+	return v;
+}
+
+/* Kinds of model option values */
+enum lzdg_option_kind {
+	LZDG_OPT_UINT,   /**< `uint64_t` in range [min;max] */
+	LZDG_OPT_DOUBLE, /**< `double` in range [min;max] */
+	LZDG_OPT_ENUM,   /**< `unsigned int` index of value in `names` */
+	LZDG_OPT_STRING  /**< `const char *` pointing into the option */
+};
+
+/**
+ * Definition of a model option.
+ *
+ * Models describe their options with an array of these, ending with an
+ * entry where `name` is `NULL`, and `lzdg_parse_options` stores the values
+ * in their parameter struct.
+ */
+struct lzdg_option {
+	const char *name;            /**< Option name */
+	enum lzdg_option_kind kind;  /**< Kind of value */
+	size_t offset;               /**< Offset of value in parameter struct */
+	double min;                  /**< Minimum value for UINT and DOUBLE */
+	double max;                  /**< Maximum value for UINT and DOUBLE */
+	const char *names;           /**< Comma separated values for ENUM */
+	const char *error;           /**< Error message for invalid value */
+};
+
+/*
+ * Nominal block size models place their data by, so structure like
+ * alignment of records and continuity of time holds across blocks of this
+ * size, the block size of `lzdgen --jobs`.
+ */
+#define LZDG_NOMINAL_BLOCK (1024 * 1024)
+
+/**
+ * Type of model, see `lzdg_model_create`.
+ */
+struct lzdg_model_type {
+	const char *name;        /**< Name used to select the model */
+	const char *description; /**< Short description for listings */
+
+	/**
+	 * Create model state from `options`.
+	 *
+	 * @return pointer to state, or `NULL` with `*error` set on error
+	 */
+	void *(*create)(const char *const *options, size_t num_options, uint64_t seed, const char **error);
+
+	/** Generate block `index` of the stream into `ptr`. */
+	void (*generate)(const void *state, unsigned char *ptr, size_t size, uint64_t index);
+
+	/** Free model state. */
+	void (*destroy)(void *state);
+};
+
+/**
+ * Parse `options` of the form KEY=VALUE into `params`, using `defs`.
+ *
+ * @param defs option definitions
+ * @param params pointer to parameter struct
+ * @param options array of options
+ * @param num_options number of options
+ * @param error pointer to where to store error message
+ * @return 0 on success
+ */
+int
+lzdg_parse_options(const struct lzdg_option *defs, void *params,
+                   const char *const *options, size_t num_options,
+                   const char **error);
+
+/**
+ * Table for sampling values from a discrete distribution.
+ *
+ * Values are found from a 31-bit cumulative distribution, starting from a
+ * guide table indexed by the top bits of the random value, so sampling
+ * usually takes only a couple of comparisons.
+ */
+struct lzdg_sampler {
+	uint32_t *cdf;            /**< Cumulative distribution, scaled to 2^31 */
+	uint32_t *guide;          /**< First value for each range of guide */
+	unsigned int guide_shift; /**< Shift from 31-bit value to guide index */
+};
+
+/**
+ * Set up `s` to sample values in range [0;n) with probability proportional
+ * to `weights`.
+ *
+ * @return 0 on success
+ */
+int
+lzdg_sampler_init(struct lzdg_sampler *s, const double *weights, size_t n);
+
+/**
+ * Set up `s` to sample ranks in range [0;n) from a Zipf distribution, where
+ * the probability of rank `k` is proportional to `1 / (k + 1)^exponent`.
+ *
+ * @return 0 on success
+ */
+int
+lzdg_sampler_init_zipf(struct lzdg_sampler *s, size_t n, double exponent);
+
+/**
+ * Free memory used by `s`.
+ */
+void
+lzdg_sampler_free(struct lzdg_sampler *s);
+
+/**
+ * Sample a value from `s`.
+ *
+ * @param u 32-bit random value
+ * @return value sampled
+ */
+static inline size_t
+lzdg_sample(const struct lzdg_sampler *s, uint32_t u)
+{
+	size_t r;
+
+	u >>= 1;
+
+	r = s->guide[u >> s->guide_shift];
+
+	while (s->cdf[r] <= u) {
+		++r;
+	}
+
+	return r;
+}
+
+/* Number of bytes dictionary words are padded with, see `lzdg_dict_emit` */
+#define LZDG_DICT_PAD 16
+
+/**
+ * Dictionary of strings sampled by rank, used for categorical fields.
+ */
+struct lzdg_dict {
+	struct lzdg_sampler ranks; /**< Sampler of string index */
+	uint32_t *offs;            /**< Offset of each string, and of the end */
+	unsigned char *arena;      /**< Strings, padded with LZDG_DICT_PAD bytes */
+	size_t num;                /**< Number of strings */
+	size_t max_len;            /**< Length of longest string */
+};
+
+/**
+ * Set up `d` with `num` strings from `words`, where they are stored back to
+ * back, each terminated by a zero byte.
+ *
+ * Strings are sampled with probability proportional to `weights`, or from a
+ * Zipf distribution with `exponent` in the order given if `weights` is
+ * `NULL`.
+ *
+ * @return 0 on success
+ */
+int
+lzdg_dict_init(struct lzdg_dict *d, const char *words, size_t num,
+               const double *weights, double exponent);
+
+/**
+ * Free memory used by `d`.
+ */
+void
+lzdg_dict_free(struct lzdg_dict *d);
+
+/* Limits for lengths of words from `lzdg_build_words` */
+#define LZDG_MIN_WORD_LEN 3
+#define LZDG_MAX_WORD_LEN 10
+
+/**
+ * Write `num` random words of alternating consonants and vowels to `buf`,
+ * back to back, each terminated by a zero byte, as `lzdg_dict_init` takes
+ * them. `buf` must have room for `num * (LZDG_MAX_WORD_LEN + 1)` bytes.
+ *
+ * @return pointer to the byte following the last word
+ */
+char *
+lzdg_build_words(struct rng_state *rng, char *buf, size_t num);
+
+/**
+ * Copy string `i` of `d` to `p`.
+ *
+ * Short strings are copied with a fixed size copy, so up to LZDG_DICT_PAD
+ * bytes past the string may be written.
+ *
+ * @return pointer to the byte following the string
+ */
+static inline unsigned char *
+lzdg_dict_emit(const struct lzdg_dict *d, size_t i, unsigned char *p)
+{
+	size_t len = d->offs[i + 1] - d->offs[i];
+
+	if (len <= LZDG_DICT_PAD) {
+		memcpy(p, d->arena + d->offs[i], LZDG_DICT_PAD);
+	}
+	else {
+		memcpy(p, d->arena + d->offs[i], len);
+	}
+
+	return p + len;
+}
+
+/* Pairs of decimal digits "00" to "99" */
+extern const char lzdg_digit_pairs[200];
+
+/* Maximum number of bytes written by `lzdg_format_uint` */
+#define LZDG_UINT_DIGITS 20
+
+/**
+ * Write decimal representation of `v` to `p`.
+ *
+ * @return pointer to the byte following the number
+ */
+static inline unsigned char *
+lzdg_format_uint(unsigned char *p, uint64_t v)
+{
+	unsigned char buf[LZDG_UINT_DIGITS];
+	unsigned char *q = buf + LZDG_UINT_DIGITS;
+	size_t len;
+
+	while (v >= 100) {
+		q -= 2;
+		memcpy(q, &lzdg_digit_pairs[2 * (v % 100)], 2);
+		v /= 100;
+	}
+
+	if (v >= 10) {
+		q -= 2;
+		memcpy(q, &lzdg_digit_pairs[2 * v], 2);
+	}
+	else {
+		*--q = (unsigned char) ('0' + v);
+	}
+
+	len = (size_t) (buf + LZDG_UINT_DIGITS - q);
+
+	memcpy(p, q, len);
+
+	return p + len;
+}
+
+/**
+ * Write `v / 10^decimals` in decimal with `decimals` digits after the point.
+ *
+ * @return pointer to the byte following the number
+ */
+static inline unsigned char *
+lzdg_format_fixed(unsigned char *p, uint64_t v, unsigned int decimals)
+{
+	uint64_t scale = 1;
+	uint64_t frac;
+	unsigned int i;
+
+	for (i = 0; i < decimals; ++i) {
+		scale *= 10;
+	}
+
+	p = lzdg_format_uint(p, v / scale);
+
+	if (decimals == 0) {
+		return p;
+	}
+
+	*p = '.';
+
+	for (i = decimals, frac = v % scale; i > 0; --i, frac /= 10) {
+		p[i] = (unsigned char) ('0' + frac % 10);
+	}
+
+	return p + decimals + 1;
+}
+
+/**
+ * Write two digit decimal representation of `v`, which must be below 100.
+ */
+static inline unsigned char *
+lzdg_put2(unsigned char *p, uint32_t v)
+{
+	memcpy(p, &lzdg_digit_pairs[2 * v], 2);
+
+	return p + 2;
+}
+
+/**
+ * Write the low `num_digits` hexadecimal digits of `v`, in lower case.
+ */
+static inline unsigned char *
+lzdg_put_hex(unsigned char *p, uint64_t v, unsigned int num_digits)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_digits; ++i) {
+		p[i] = (unsigned char) "0123456789abcdef"[(v >> (4 * (num_digits - 1 - i))) & 15];
+	}
+
+	return p + num_digits;
+}
+
+/**
+ * Write the low `num_bytes` bytes of `v` in little-endian order.
+ */
+static inline unsigned char *
+lzdg_put_le(unsigned char *p, uint64_t v, unsigned int num_bytes)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_bytes; ++i) {
+		p[i] = (unsigned char) (v >> (8 * i));
+	}
+
+	return p + num_bytes;
+}
+
+/**
+ * Insert the `end - p` bytes left at the end of a block as spaces at `at`,
+ * moving the bytes from `at` to `p` after them.
+ */
+static inline void
+lzdg_pad_at(unsigned char *at, unsigned char *p, unsigned char *end)
+{
+	size_t num = (size_t) (end - p);
+
+	memmove(at + num, at, (size_t) (p - at));
+	memset(at, ' ', num);
+}
+
+/**
+ * End a block of lines at `ptr` on a line boundary, where `p` is the end
+ * of the last complete line. The bytes left are spaces added to the end of
+ * the last line, or, if there is no line, a line of spaces.
+ */
+static inline void
+lzdg_pad_lines(unsigned char *ptr, unsigned char *p, unsigned char *end)
+{
+	if (p == end) {
+		return;
+	}
+
+	if (p == ptr) {
+		memset(ptr, ' ', (size_t) (end - ptr));
+		end[-1] = '\n';
+	}
+	else {
+		lzdg_pad_at(p - 1, p, end);
+	}
+}
+
+/**
+ * Broken down time in UTC, see `lzdg_gmtime`.
+ */
+struct lzdg_tm {
+	uint32_t year; /**< Year, 1970 and up */
+	uint32_t mon;  /**< Month, 1 to 12 */
+	uint32_t day;  /**< Day of month, 1 to 31 */
+	uint32_t hour; /**< Hour, 0 to 23 */
+	uint32_t min;  /**< Minute, 0 to 59 */
+	uint32_t sec;  /**< Second, 0 to 59 */
+	uint32_t ms;   /**< Millisecond, 0 to 999 */
+};
+
+/**
+ * Convert `ms` milliseconds since 1970 to date and time in UTC.
+ */
+void
+lzdg_gmtime(uint64_t ms, struct lzdg_tm *tm);
+
+/**
+ * Write date of `tm` as `YYYY-MM-DD`.
+ */
+static inline unsigned char *
+lzdg_put_date(unsigned char *p, const struct lzdg_tm *tm)
+{
+	p = lzdg_put2(p, tm->year / 100 % 100);
+	p = lzdg_put2(p, tm->year % 100);
+	*p++ = '-';
+	p = lzdg_put2(p, tm->mon);
+	*p++ = '-';
+	return lzdg_put2(p, tm->day);
+}
+
+/**
+ * Write time of day of `tm` as `HH:MM:SS`.
+ */
+static inline unsigned char *
+lzdg_put_clock(unsigned char *p, const struct lzdg_tm *tm)
+{
+	p = lzdg_put2(p, tm->hour);
+	*p++ = ':';
+	p = lzdg_put2(p, tm->min);
+	*p++ = ':';
+	return lzdg_put2(p, tm->sec);
+}
+
+/**
+ * Bulk mode generation set up once for a ratio and exponents, see
+ * `lzdg_bulk_create`.
+ */
+struct lzdg_bulk;
+
+/**
+ * Set up bulk mode generation with the given parameters.
+ *
+ * Setting up the tables takes as long as generating many kilobytes, so
+ * models that generate small parts of bulk data set it up once, and share
+ * it between threads.
+ *
+ * @return pointer to bulk parameters, or `NULL` if out of memory
+ */
+struct lzdg_bulk *
+lzdg_bulk_create(double ratio, double len_exp, double lit_exp);
+
+/**
+ * Generate block `index` of the bulk mode stream given by `seed`.
+ *
+ * Gives the same data as `lzdg_generate_block` with `LZDG_FLAG_BULK` and
+ * the parameters of `bulk`.
+ */
+void
+lzdg_bulk_generate(const struct lzdg_bulk *bulk, void *ptr, size_t size, uint64_t seed, uint64_t index);
+
+/**
+ * Free bulk parameters created with `lzdg_bulk_create`.
+ */
+void
+lzdg_bulk_free(struct lzdg_bulk *bulk);
+
+/* Model types */
+extern const struct lzdg_model_type lzdg_text_model;
+extern const struct lzdg_model_type lzdg_log_model;
+extern const struct lzdg_model_type lzdg_json_model;
+extern const struct lzdg_model_type lzdg_table_model;
+extern const struct lzdg_model_type lzdg_int_model;
+extern const struct lzdg_model_type lzdg_float_model;
+extern const struct lzdg_model_type lzdg_stride_model;
+
+#endif /* LZDG_INTERNAL_H_INCLUDED */
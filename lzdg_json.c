@@ -0,0 +1,861 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * JSON model.
+ *
+ * A random schema of nested objects, arrays and typed values is generated
+ * from the seed, and compiled directly into an emit plan, a list of
+ * operations where the keys and punctuation between values are merged into
+ * text copies, and arrays and optional fields are jumps. Documents are
+ * generated by running the plan, and can be written as NDJSON, indented
+ * JSON or XML.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum nesting depth of documents */
+#define JSON_MAX_DEPTH 8
+
+/* Maximum length of merged text operations */
+#define JSON_MAX_TEXT 256
+
+/* Maximum number of fields in an object */
+#define JSON_MAX_FIELDS 256
+
+/* Time of first date values, 2023-01-01, and span of date values in seconds */
+#define DATE_START 1672531200
+#define DATE_SPAN (365 * 86400)
+
+enum json_format {
+	FORMAT_NDJSON,
+	FORMAT_PRETTY,
+	FORMAT_XML
+};
+
+struct json_params {
+	unsigned int format;
+	uint64_t depth;
+	uint64_t fields;
+	uint64_t array_len;
+	uint64_t keys;
+	uint64_t vocab;
+	uint64_t string_len;
+	double optional;
+	double nulls;
+	double zipf;
+};
+
+static const struct lzdg_option json_options[] = {
+	{ "format", LZDG_OPT_ENUM, offsetof(struct json_params, format), 0, 0, "ndjson,pretty,xml",
+	  "json format must be ndjson, pretty or xml" },
+	{ "depth", LZDG_OPT_UINT, offsetof(struct json_params, depth), 1, JSON_MAX_DEPTH, NULL,
+	  "json depth must be 1 to 8" },
+	{ "fields", LZDG_OPT_UINT, offsetof(struct json_params, fields), 1, 100, NULL,
+	  "json fields must be 1 to 100" },
+	{ "array_len", LZDG_OPT_UINT, offsetof(struct json_params, array_len), 0, 1000, NULL,
+	  "json array_len must be 0 to 1000" },
+	{ "keys", LZDG_OPT_UINT, offsetof(struct json_params, keys), 1, 10000, NULL,
+	  "json keys must be 1 to 10000" },
+	{ "vocab", LZDG_OPT_UINT, offsetof(struct json_params, vocab), 1, 1000000, NULL,
+	  "json vocab must be 1 to 1000000" },
+	{ "string_len", LZDG_OPT_UINT, offsetof(struct json_params, string_len), 1, 32, NULL,
+	  "json string_len must be 1 to 32" },
+	{ "optional", LZDG_OPT_DOUBLE, offsetof(struct json_params, optional), 0, 1, NULL,
+	  "json optional must be 0.0 to 1.0" },
+	{ "nulls", LZDG_OPT_DOUBLE, offsetof(struct json_params, nulls), 0, 1, NULL,
+	  "json nulls must be 0.0 to 1.0" },
+	{ "zipf", LZDG_OPT_DOUBLE, offsetof(struct json_params, zipf), 0, 4, NULL,
+	  "json zipf must be 0.0 to 4.0" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+/* Common keys, used before generated ones */
+static const char *const common_keys[] = {
+	"id", "name", "type", "status", "created_at", "updated_at", "user_id",
+	"email", "title", "description", "price", "quantity", "tags", "items",
+	"metadata", "count", "value", "enabled", "score", "category", "url",
+	"version", "timestamp", "owner", "address", "city", "country", "code",
+	"level", "source", "target", "amount", "currency", "labels",
+	"attributes", "children", "parent_id", "priority", "state", "message"
+};
+
+enum json_op_type {
+	OP_TEXT,     /**< Copy text */
+	OP_OPTIONAL, /**< Jump with probability threshold / 2^32 */
+	OP_ARRAY,    /**< Start array of mean length a, jump if empty */
+	OP_NEXT,     /**< Jump to next array element if any */
+	OP_ENUM,     /**< String from dictionary enums[a] */
+	OP_NAME,     /**< One or two capitalized words */
+	OP_WORDS,    /**< String of words with mean length a */
+	OP_ID,       /**< String of a hexadecimal digits */
+	OP_INT,      /**< Integer in range [a;a+b] */
+	OP_FLOAT,    /**< Number in range [0;a) / 10^b with b decimals */
+	OP_BOOL,     /**< true with probability threshold / 2^32 */
+	OP_DATE      /**< ISO 8601 date and time string */
+};
+
+struct json_op {
+	enum json_op_type type;
+	uint32_t jump;      /**< Index of operation to jump to */
+	uint32_t threshold; /**< Probability scaled to 2^32 */
+	uint64_t a;
+	uint64_t b;
+	uint32_t text;      /**< Offset of text, or of array open or separator */
+	uint32_t text_len;
+	uint32_t text2;     /**< Offset of array empty or close text */
+	uint32_t text2_len;
+	uint32_t max_len;   /**< Maximum number of bytes written, with slack */
+};
+
+struct json_model {
+	struct json_params params;
+	struct lzdg_dict vocab;
+	struct lzdg_dict keys;
+	struct lzdg_dict *enums;
+	size_t num_enums;
+	struct json_op *ops;
+	size_t num_ops;
+	char *text;
+	size_t text_size;
+	uint32_t null_threshold;
+	unsigned char quote;
+	uint64_t seed;
+};
+
+/* State while compiling the schema */
+struct json_builder {
+	struct json_model *m;
+	struct rng_state *rng;
+	char *words;
+	int can_merge;
+	int failed;
+};
+
+/* State while running the plan */
+struct json_state {
+	size_t pc;
+	unsigned int sp;
+	uint32_t counts[JSON_MAX_DEPTH];
+	struct rng_bits bits;
+};
+
+static uint32_t
+probability(double p)
+{
+	return p >= 1.0 ? UINT32_MAX : (uint32_t) (p * 4294967296.0);
+}
+
+/* Append text to text buffer, returns offset */
+static uint32_t
+add_text(struct json_builder *b, const char *s, size_t len)
+{
+	struct json_model *m = b->m;
+	char *text = (char *) realloc(m->text, m->text_size + len + 1);
+	uint32_t offs = (uint32_t) m->text_size;
+
+	if (text == NULL) {
+		b->failed = 1;
+		return 0;
+	}
+
+	m->text = text;
+
+	memcpy(m->text + m->text_size, s, len);
+	m->text_size += len;
+
+	return offs;
+}
+
+static struct json_op *
+add_op(struct json_builder *b, enum json_op_type type, size_t max_len)
+{
+	struct json_model *m = b->m;
+	struct json_op *ops = (struct json_op *) realloc(m->ops, (m->num_ops + 1) * sizeof(m->ops[0]));
+	struct json_op *op;
+
+	if (ops == NULL) {
+		b->failed = 1;
+		return NULL;
+	}
+
+	m->ops = ops;
+
+	op = &ops[m->num_ops++];
+
+	memset(op, 0, sizeof(*op));
+
+	op->type = type;
+	op->max_len = (uint32_t) (max_len + LZDG_DICT_PAD);
+
+	b->can_merge = 1;
+
+	return op;
+}
+
+/* Mark the next operation as a jump target, so text is not merged into it */
+static uint32_t
+jump_target(struct json_builder *b)
+{
+	b->can_merge = 0;
+
+	return (uint32_t) b->m->num_ops;
+}
+
+static void
+emit_text(struct json_builder *b, const char *s, size_t len)
+{
+	struct json_model *m = b->m;
+	struct json_op *op = m->num_ops ? &m->ops[m->num_ops - 1] : NULL;
+
+	if (b->failed || len == 0) {
+		return;
+	}
+
+	/* Extend previous text if possible, so it is copied at once */
+	if (b->can_merge && op != NULL && op->type == OP_TEXT
+	 && op->text + op->text_len == m->text_size
+	 && op->text_len + len <= JSON_MAX_TEXT) {
+		add_text(b, s, len);
+		op->text_len += (uint32_t) len;
+		op->max_len += (uint32_t) len;
+		return;
+	}
+
+	op = add_op(b, OP_TEXT, len);
+
+	if (op != NULL) {
+		op->text = add_text(b, s, len);
+		op->text_len = (uint32_t) len;
+	}
+}
+
+static void
+emit_indent(struct json_builder *b, const char *prefix, unsigned int depth)
+{
+	char buf[64];
+	size_t len = strlen(prefix);
+
+	memcpy(buf, prefix, len);
+	memset(buf + len, ' ', 2 * depth);
+
+	emit_text(b, buf, len + 2 * depth);
+}
+
+/* Set text of `op` to `s` and text2 to `s2` */
+static void
+set_texts(struct json_builder *b, struct json_op *op, const char *s, const char *s2)
+{
+	size_t len = strlen(s);
+	size_t len2 = strlen(s2);
+
+	op->text = add_text(b, s, len);
+	op->text_len = (uint32_t) len;
+	op->text2 = add_text(b, s2, len2);
+	op->text2_len = (uint32_t) len2;
+	op->max_len += (uint32_t) (len > len2 ? len : len2);
+}
+
+static void compile_object(struct json_builder *b, unsigned int depth);
+
+static void
+compile_primitive(struct json_builder *b)
+{
+	struct json_model *m = b->m;
+	struct rng_state *rng = b->rng;
+	size_t max_word = m->vocab.max_len + 1;
+	uint32_t u = lzdg_uniform(rng, 100);
+	struct json_op *op;
+
+	if (u < 25) {
+		/* Enumeration of 2 to 32 words */
+		struct lzdg_dict *enums;
+		uint32_t card = 2U << lzdg_uniform(rng, 5);
+		char *q = b->words;
+		uint32_t i;
+
+		enums = (struct lzdg_dict *) realloc(m->enums, (m->num_enums + 1) * sizeof(m->enums[0]));
+
+		if (enums == NULL) {
+			b->failed = 1;
+			return;
+		}
+
+		m->enums = enums;
+
+		for (i = 0; i < card; ++i) {
+			size_t w = lzdg_sample(&m->vocab.ranks, rng_next32(rng));
+			size_t len = m->vocab.offs[w + 1] - m->vocab.offs[w];
+
+			memcpy(q, m->vocab.arena + m->vocab.offs[w], len);
+			q[len] = '\0';
+			q += len + 1;
+		}
+
+		if (lzdg_dict_init(&m->enums[m->num_enums], b->words, card, NULL, m->params.zipf)) {
+			b->failed = 1;
+			return;
+		}
+
+		if ((op = add_op(b, OP_ENUM, m->enums[m->num_enums].max_len + 2)) != NULL) {
+			op->a = m->num_enums;
+		}
+
+		m->num_enums++;
+	}
+	else if (u < 45) {
+		/* Small counts, medium values or large identifiers */
+		static const uint64_t ranges[3][2] = {
+			{ 0, 0 }, { 0, 99999 }, { 100000, 999899999 }
+		};
+		uint32_t kind = lzdg_uniform(rng, 3);
+
+		if ((op = add_op(b, OP_INT, LZDG_UINT_DIGITS)) != NULL) {
+			op->a = ranges[kind][0];
+			op->b = kind == 0 ? (UINT64_C(2) << lzdg_uniform(rng, 10)) - 1 : ranges[kind][1];
+		}
+	}
+	else if (u < 55) {
+		static const uint64_t powers[5] = { 1, 10, 100, 1000, 10000 };
+		uint32_t decimals = 1 + lzdg_uniform(rng, 4);
+
+		if ((op = add_op(b, OP_FLOAT, LZDG_UINT_DIGITS + 6)) != NULL) {
+			op->a = powers[1 + lzdg_uniform(rng, 4)] * powers[decimals];
+			op->b = decimals;
+		}
+	}
+	else if (u < 65) {
+		add_op(b, OP_NAME, 2 * max_word + 2);
+	}
+	else if (u < 73) {
+		if ((op = add_op(b, OP_WORDS, 2 * m->params.string_len * max_word + 2)) != NULL) {
+			op->a = m->params.string_len;
+		}
+	}
+	else if (u < 81) {
+		if ((op = add_op(b, OP_ID, 32 + 2)) != NULL) {
+			op->a = 16 + 8 * lzdg_uniform(rng, 3);
+		}
+	}
+	else if (u < 89) {
+		if ((op = add_op(b, OP_BOOL, 5)) != NULL) {
+			op->threshold = probability(0.1 + 0.8 * rand_double(rng));
+		}
+	}
+	else {
+		add_op(b, OP_DATE, 22);
+	}
+}
+
+static void
+compile_array(struct json_builder *b, unsigned int depth)
+{
+	struct json_model *m = b->m;
+	struct json_op *op;
+	size_t array_op;
+	uint32_t body;
+	char open[64];
+	char sep[64];
+	char close[64];
+
+	if ((op = add_op(b, OP_ARRAY, 0)) == NULL) {
+		return;
+	}
+
+	op->a = m->params.array_len;
+	array_op = m->num_ops - 1;
+
+	switch (m->params.format) {
+	case FORMAT_NDJSON:
+		set_texts(b, op, "[", "[]");
+		break;
+	case FORMAT_PRETTY:
+		strcpy(open, "[\n");
+		memset(open + 2, ' ', 2 * (depth + 1));
+		open[2 + 2 * (depth + 1)] = '\0';
+		set_texts(b, op, open, "[]");
+		break;
+	default:
+		set_texts(b, op, "<item>", "");
+		break;
+	}
+
+	body = jump_target(b);
+
+	/* Elements are objects or values */
+	if (depth + 1 < m->params.depth && lzdg_uniform(b->rng, 2) == 0) {
+		compile_object(b, depth + 1);
+	}
+	else {
+		compile_primitive(b);
+	}
+
+	if (b->failed || (op = add_op(b, OP_NEXT, 0)) == NULL) {
+		return;
+	}
+
+	op->jump = body;
+
+	switch (m->params.format) {
+	case FORMAT_NDJSON:
+		set_texts(b, op, ",", "]");
+		break;
+	case FORMAT_PRETTY:
+		strcpy(sep, ",\n");
+		memset(sep + 2, ' ', 2 * (depth + 1));
+		sep[2 + 2 * (depth + 1)] = '\0';
+		close[0] = '\n';
+		memset(close + 1, ' ', 2 * depth);
+		close[1 + 2 * depth] = ']';
+		close[2 + 2 * depth] = '\0';
+		set_texts(b, op, sep, close);
+		break;
+	default:
+		set_texts(b, op, "</item><item>", "</item>");
+		break;
+	}
+
+	m->ops[array_op].jump = jump_target(b);
+}
+
+static void
+compile_object(struct json_builder *b, unsigned int depth)
+{
+	struct json_model *m = b->m;
+	struct rng_state *rng = b->rng;
+	size_t keys[JSON_MAX_FIELDS];
+	uint32_t num_fields = 1 + lzdg_uniform(rng, (uint32_t) m->params.fields) + lzdg_uniform(rng, (uint32_t) m->params.fields);
+	uint32_t optional = probability(m->params.optional);
+	uint32_t i;
+	uint32_t j;
+
+	if (m->params.format != FORMAT_XML) {
+		emit_text(b, "{", 1);
+	}
+
+	for (i = 0; i < num_fields && !b->failed; ++i) {
+		const char *key;
+		size_t key_len;
+		size_t optional_op = 0;
+		unsigned int tries;
+		char buf[128];
+		size_t len;
+		uint32_t u;
+
+		/* Keys are sampled by rank, without repeats in an object */
+		for (tries = 0; tries < 8; ++tries) {
+			keys[i] = lzdg_sample(&m->keys.ranks, rng_next32(rng));
+
+			for (j = 0; j < i && keys[j] != keys[i]; ++j) {
+			}
+
+			if (j == i) {
+				break;
+			}
+		}
+
+		if (tries == 8) {
+			num_fields = i;
+			break;
+		}
+
+		key = (const char *) m->keys.arena + m->keys.offs[keys[i]];
+		key_len = m->keys.offs[keys[i] + 1] - m->keys.offs[keys[i]];
+
+		/* Fields after the first may be optional, and left out half of the time */
+		if (i > 0 && rng_next32(rng) < optional) {
+			struct json_op *op = add_op(b, OP_OPTIONAL, 0);
+
+			if (op == NULL) {
+				return;
+			}
+
+			op->threshold = UINT32_C(0x80000000);
+			optional_op = m->num_ops - 1;
+		}
+
+		switch (m->params.format) {
+		case FORMAT_NDJSON:
+			len = (size_t) sprintf(buf, "%s\"%.*s\":", i ? "," : "", (int) key_len, key);
+			emit_text(b, buf, len);
+			break;
+		case FORMAT_PRETTY:
+			emit_indent(b, i ? ",\n" : "\n", depth + 1);
+			len = (size_t) sprintf(buf, "\"%.*s\": ", (int) key_len, key);
+			emit_text(b, buf, len);
+			break;
+		default:
+			len = (size_t) sprintf(buf, "<%.*s>", (int) key_len, key);
+			emit_text(b, buf, len);
+			break;
+		}
+
+		/* Values are mostly primitive, unless at maximum depth */
+		u = lzdg_uniform(rng, 100);
+
+		if (depth + 1 < m->params.depth && u < 10) {
+			compile_object(b, depth + 1);
+		}
+		else if (depth + 1 < m->params.depth && u < 22) {
+			compile_array(b, depth + 1);
+		}
+		else {
+			compile_primitive(b);
+		}
+
+		if (m->params.format == FORMAT_XML) {
+			len = (size_t) sprintf(buf, "</%.*s>", (int) key_len, key);
+			emit_text(b, buf, len);
+		}
+
+		if (optional_op != 0) {
+			m->ops[optional_op].jump = jump_target(b);
+		}
+	}
+
+	switch (m->params.format) {
+	case FORMAT_NDJSON:
+		emit_text(b, "}", 1);
+		break;
+	case FORMAT_PRETTY:
+		emit_indent(b, "\n", depth);
+		emit_text(b, "}", 1);
+		break;
+	default:
+		break;
+	}
+}
+
+static int
+build_vocabulary(struct json_model *m, struct rng_state *rng, char *buf)
+{
+	char *q;
+	size_t i;
+
+	lzdg_build_words(rng, buf, (size_t) m->params.vocab);
+
+	if (lzdg_dict_init(&m->vocab, buf, (size_t) m->params.vocab, NULL, m->params.zipf)) {
+		return 1;
+	}
+
+	/* Keys are common keys, then pairs of words joined by underscore */
+	for (i = 0, q = buf; i < m->params.keys; ++i) {
+		if (i < ARRAY_SIZE(common_keys)) {
+			q += sprintf(q, "%s", common_keys[i]) + 1;
+		}
+		else {
+			size_t w1 = lzdg_uniform(rng, (uint32_t) m->params.vocab);
+			size_t w2 = lzdg_uniform(rng, (uint32_t) m->params.vocab);
+
+			q += sprintf(q, "%.*s_%.*s",
+			             (int) (m->vocab.offs[w1 + 1] - m->vocab.offs[w1]),
+			             (const char *) m->vocab.arena + m->vocab.offs[w1],
+			             (int) (m->vocab.offs[w2 + 1] - m->vocab.offs[w2]),
+			             (const char *) m->vocab.arena + m->vocab.offs[w2]) + 1;
+		}
+	}
+
+	return lzdg_dict_init(&m->keys, buf, (size_t) m->params.keys, NULL, m->params.zipf);
+}
+
+static void
+json_destroy(void *state)
+{
+	struct json_model *m = (struct json_model *) state;
+	size_t i;
+
+	if (m == NULL) {
+		return;
+	}
+
+	for (i = 0; i < m->num_enums; ++i) {
+		lzdg_dict_free(&m->enums[i]);
+	}
+
+	lzdg_dict_free(&m->keys);
+	lzdg_dict_free(&m->vocab);
+	free(m->enums);
+	free(m->text);
+	free(m->ops);
+	free(m);
+}
+
+static void *
+json_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct json_params params = { FORMAT_NDJSON, 3, 8, 4, 64, 2000, 8, 0.1, 0.02, 1.0 };
+	struct json_builder b;
+	struct json_model *m;
+	struct rng_state rng;
+	size_t buf_size;
+
+	if (lzdg_parse_options(json_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	m = (struct json_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->params = params;
+	m->seed = seed;
+	m->null_threshold = (uint32_t) (params.nulls * 65536.0);
+	m->quote = params.format == FORMAT_XML ? 0 : '"';
+
+	rng_seed(&rng, seed ^ UINT64_C(0x9E3779B97F4A7C15));
+
+	/* Buffer for vocabulary words and keys, which are at most 2 words */
+	buf_size = (size_t) (params.vocab > params.keys ? params.vocab : params.keys)
+	         * (2 * LZDG_MAX_WORD_LEN + 2) + 64;
+
+	b.m = m;
+	b.rng = &rng;
+	b.words = (char *) malloc(buf_size);
+	b.can_merge = 0;
+	b.failed = 0;
+
+	if (b.words == NULL || build_vocabulary(m, &rng, b.words)) {
+		free(b.words);
+		json_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	if (params.format == FORMAT_XML) {
+		emit_text(&b, "<doc>", 5);
+	}
+
+	compile_object(&b, 0);
+
+	emit_text(&b, params.format == FORMAT_XML ? "</doc>\n" : "\n",
+	          params.format == FORMAT_XML ? 7 : 1);
+
+	free(b.words);
+
+	if (b.failed) {
+		json_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	return m;
+}
+
+static unsigned char *
+emit_word(const struct json_model *m, struct rng_state *rng, unsigned char *p)
+{
+	return lzdg_dict_emit(&m->vocab, lzdg_sample(&m->vocab.ranks, rng_next32(rng)), p);
+}
+
+static unsigned char *
+run_op(const struct json_model *m, struct rng_state *rng, struct json_state *s,
+       unsigned char *p)
+{
+	const struct json_op *op = &m->ops[s->pc++];
+
+	switch (op->type) {
+	case OP_TEXT:
+		memcpy(p, m->text + op->text, op->text_len);
+		return p + op->text_len;
+	case OP_OPTIONAL:
+		if (rng_next32(rng) < op->threshold) {
+			s->pc = op->jump;
+		}
+		return p;
+	case OP_ARRAY: {
+		uint32_t n = lzdg_uniform(rng, (uint32_t) op->a + 1) + lzdg_uniform(rng, (uint32_t) op->a + 1);
+
+		if (n == 0) {
+			memcpy(p, m->text + op->text2, op->text2_len);
+			s->pc = op->jump;
+			return p + op->text2_len;
+		}
+
+		s->counts[s->sp++] = n;
+
+		memcpy(p, m->text + op->text, op->text_len);
+		return p + op->text_len;
+	}
+	case OP_NEXT:
+		if (--s->counts[s->sp - 1] != 0) {
+			memcpy(p, m->text + op->text, op->text_len);
+			s->pc = op->jump;
+			return p + op->text_len;
+		}
+
+		s->sp--;
+
+		memcpy(p, m->text + op->text2, op->text2_len);
+		return p + op->text2_len;
+	default:
+		break;
+	}
+
+	/* Values may be null */
+	if (rng_take_bits(rng, &s->bits, 16) < m->null_threshold) {
+		if (m->quote) {
+			memcpy(p, "null", 4);
+			p += 4;
+		}
+		return p;
+	}
+
+	switch (op->type) {
+	case OP_ENUM: {
+		const struct lzdg_dict *d = &m->enums[op->a];
+
+		*p = m->quote;
+		p += m->quote != 0;
+		p = lzdg_dict_emit(d, lzdg_sample(&d->ranks, rng_next32(rng)), p);
+		*p = m->quote;
+		p += m->quote != 0;
+		break;
+	}
+	case OP_NAME: {
+		unsigned char *w;
+
+		*p = m->quote;
+		p += m->quote != 0;
+		w = p;
+		p = emit_word(m, rng, p);
+		*w = (unsigned char) (*w - 'a' + 'A');
+		if (rng_take_bits(rng, &s->bits, 1)) {
+			*p++ = ' ';
+			w = p;
+			p = emit_word(m, rng, p);
+			*w = (unsigned char) (*w - 'a' + 'A');
+		}
+		*p = m->quote;
+		p += m->quote != 0;
+		break;
+	}
+	case OP_WORDS: {
+		uint32_t n = 1 + lzdg_uniform(rng, (uint32_t) op->a) + lzdg_uniform(rng, (uint32_t) op->a);
+
+		*p = m->quote;
+		p += m->quote != 0;
+		p = emit_word(m, rng, p);
+		while (--n != 0) {
+			*p++ = ' ';
+			p = emit_word(m, rng, p);
+		}
+		*p = m->quote;
+		p += m->quote != 0;
+		break;
+	}
+	case OP_ID:
+		*p = m->quote;
+		p += m->quote != 0;
+		p = lzdg_put_hex(p, rng_next64(rng), 16);
+		if (op->a > 16) {
+			p = lzdg_put_hex(p, rng_next64(rng), (unsigned int) op->a - 16);
+		}
+		*p = m->quote;
+		p += m->quote != 0;
+		break;
+	case OP_INT:
+		p = lzdg_format_uint(p, op->a + rng_next64(rng) % (op->b + 1));
+		break;
+	case OP_FLOAT:
+		p = lzdg_format_fixed(p, rng_next64(rng) % op->a, (unsigned int) op->b);
+		break;
+	case OP_BOOL:
+		if (rng_next32(rng) < op->threshold) {
+			memcpy(p, "true", 4);
+			p += 4;
+		}
+		else {
+			memcpy(p, "false", 5);
+			p += 5;
+		}
+		break;
+	case OP_DATE: {
+		struct lzdg_tm tm;
+
+		lzdg_gmtime((DATE_START + rng_next64(rng) % DATE_SPAN) * 1000, &tm);
+
+		*p = m->quote;
+		p += m->quote != 0;
+		p = lzdg_put_date(p, &tm);
+		*p++ = 'T';
+		p = lzdg_put_clock(p, &tm);
+		*p++ = 'Z';
+		*p = m->quote;
+		p += m->quote != 0;
+		break;
+	}
+	default:
+		break;
+	}
+
+	return p;
+}
+
+static void
+json_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct json_model *m = (const struct json_model *) state;
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	unsigned char *doc_end = ptr;
+	struct rng_state rng;
+	struct json_state s;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	s.pc = 0;
+	s.sp = 0;
+	s.bits.bits = 0;
+	s.bits.avail = 0;
+
+	/*
+	 * Run operations while they fit. The document that does not fit is
+	 * dropped, and the last whole document is padded with spaces before
+	 * its newline, so the block ends on a document boundary.
+	 */
+	while ((size_t) (end - p) >= m->ops[s.pc].max_len) {
+		p = run_op(m, &rng, &s, p);
+
+		if (s.pc == m->num_ops) {
+			s.pc = 0;
+			doc_end = p;
+		}
+	}
+
+	lzdg_pad_lines(ptr, doc_end, end);
+}
+
+const struct lzdg_model_type lzdg_json_model = {
+	"json",
+	"JSON or XML documents from a random schema",
+	json_create,
+	json_generate,
+	json_destroy
+};
@@ -0,0 +1,923 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Log model.
+ *
+ * Lines are generated from templates of text and fields, like
+ * `{time} {level} [{module}] ...`. Templates are compiled once into a list
+ * of operations, which are run for each line. Timestamps increase through
+ * the stream, categorical fields are sampled by rank from dictionaries, and
+ * numbers are formatted with digit pair tables.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum length of a line, and of a line of a templates file */
+#define LOG_MAX_LINE 4096
+
+/* Maximum number of templates */
+#define LOG_MAX_TEMPLATES 256
+
+/* Number of bytes a line may be written past its end */
+#define LOG_SLACK 32
+
+/* Number of values in table of latencies, as a power of 2 */
+#define LOG_MS_BITS 10
+#define LOG_MS_SIZE (1U << LOG_MS_BITS)
+
+/* Number of lines generated to estimate mean line length */
+#define LOG_SAMPLE_LINES 256
+
+struct log_params {
+	unsigned int format;
+	const char *templates;
+	double rate;
+	uint64_t start;
+	double latency;
+	uint64_t clients;
+	uint64_t users;
+	uint64_t paths;
+	uint64_t hosts;
+	double zipf;
+};
+
+static const struct lzdg_option log_options[] = {
+	{ "format", LZDG_OPT_ENUM, offsetof(struct log_params, format), 0, 0, "app,access,syslog",
+	  "log format must be app, access or syslog" },
+	{ "templates", LZDG_OPT_STRING, offsetof(struct log_params, templates), 0, 0, NULL,
+	  "log templates must be a file name" },
+	{ "rate", LZDG_OPT_DOUBLE, offsetof(struct log_params, rate), 1, 1e9, NULL,
+	  "log rate must be 1 to 1e9 lines per second" },
+	{ "start", LZDG_OPT_UINT, offsetof(struct log_params, start), 0, 4102444800.0, NULL,
+	  "log start must be 0 to 4102444800 seconds" },
+	{ "latency", LZDG_OPT_DOUBLE, offsetof(struct log_params, latency), 0, 1e6, NULL,
+	  "log latency must be 0 to 1e6 ms" },
+	{ "clients", LZDG_OPT_UINT, offsetof(struct log_params, clients), 1, 1000000, NULL,
+	  "log clients must be 1 to 1000000" },
+	{ "users", LZDG_OPT_UINT, offsetof(struct log_params, users), 1, 1000000, NULL,
+	  "log users must be 1 to 1000000" },
+	{ "paths", LZDG_OPT_UINT, offsetof(struct log_params, paths), 1, 1000000, NULL,
+	  "log paths must be 1 to 1000000" },
+	{ "hosts", LZDG_OPT_UINT, offsetof(struct log_params, hosts), 1, 1000, NULL,
+	  "log hosts must be 1 to 1000" },
+	{ "zipf", LZDG_OPT_DOUBLE, offsetof(struct log_params, zipf), 0, 4, NULL,
+	  "log zipf must be 0.0 to 4.0" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+/* Built-in templates, most frequent first */
+static const char *const app_templates[] = {
+	"{time} {level} [{module}] {word} {word} {word} id={id} user={user} duration_ms={ms}",
+	"{time} {level} [{module}] {method} {path} status={status} duration_ms={ms} request_id={uuid}",
+	"{time} {level} [{module}] {word} {word} from {ip} after {int:1:5} retries",
+	"{time} {level} [{module}] cache {word} key={path} size={int:0:65535}",
+	"{time} {level} [{module}] user {user} {word} session {id}",
+	"{time} {level} [{module}] {word} {word} {word} {word} queue_depth={int:0:1000}",
+	NULL
+};
+
+static const char *const access_templates[] = {
+	"{ip} - - [{time:clf}] \"{method} {path} HTTP/1.1\" {status} {int:0:100000} \"-\" \"{agent}\"",
+	"{ip} - {user} [{time:clf}] \"{method} {path} HTTP/1.1\" {status} {int:0:100000} \"-\" \"{agent}\"",
+	"{ip} - - [{time:clf}] \"{method} {path} HTTP/2.0\" {status} {int:0:10000} \"https://example.com{path}\" \"{agent}\"",
+	NULL
+};
+
+static const char *const syslog_templates[] = {
+	"{time:syslog} {host} {module}[{int:100:32767}]: {word} {word} {word}",
+	"{time:syslog} {host} sshd[{int:100:32767}]: Accepted publickey for {user} from {ip} port {int:1024:65535} ssh2",
+	"{time:syslog} {host} kernel: [{time:epoch}] {word} {word} {word} {word}",
+	"{time:syslog} {host} CRON[{int:100:32767}]: ({user}) CMD ({path})",
+	"{time:syslog} {host} sshd[{int:100:32767}]: Failed password for {user} from {ip} port {int:1024:65535} ssh2",
+	NULL
+};
+
+static const char *const *const builtin_templates[] = {
+	app_templates, access_templates, syslog_templates
+};
+
+/* Dictionaries of field values */
+enum log_dict {
+	DICT_LEVEL,
+	DICT_MODULE,
+	DICT_HOST,
+	DICT_IP,
+	DICT_USER,
+	DICT_STATUS,
+	DICT_METHOD,
+	DICT_PATH,
+	DICT_AGENT,
+	DICT_WORD,
+	NUM_DICTS
+};
+
+/* Field names of dictionaries, in the order of enum log_dict */
+static const char *const dict_names[NUM_DICTS] = {
+	"level", "module", "host", "ip", "user", "status", "method", "path", "agent", "word"
+};
+
+static const char levels[] =
+	"INFO\0DEBUG\0WARN\0ERROR\0TRACE\0FATAL";
+
+static const double level_weights[] = {
+	60, 25, 8, 4, 2.5, 0.5
+};
+
+static const char statuses[] =
+	"200\0" "304\0" "404\0" "302\0" "301\0" "400\0"
+	"500\0" "401\0" "403\0" "503\0" "201\0" "204";
+
+static const double status_weights[] = {
+	75, 6, 6, 3, 2, 2, 1, 1, 1, 0.5, 2, 0.5
+};
+
+static const char methods[] =
+	"GET\0POST\0PUT\0DELETE\0HEAD\0PATCH\0OPTIONS";
+
+static const double method_weights[] = {
+	70, 20, 4, 3, 1.5, 1, 0.5
+};
+
+static const char *const agents[] = {
+	"Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36",
+	"Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.1 Safari/605.1.15",
+	"Mozilla/5.0 (X11; Linux x86_64; rv:121.0) Gecko/20100101 Firefox/121.0",
+	"Mozilla/5.0 (iPhone; CPU iPhone OS 17_1 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.1 Mobile/15E148 Safari/604.1",
+	"curl/8.4.0",
+	"Googlebot/2.1 (+http://www.google.com/bot.html)",
+	"python-requests/2.31.0",
+	"Go-http-client/1.1"
+};
+
+static const char *const components[] = {
+	"auth", "db", "cache", "api", "http", "queue", "worker", "scheduler",
+	"billing", "user", "session", "storage", "search", "index", "metrics",
+	"config", "mail", "payment", "order", "inventory"
+};
+
+static const char *const roles[] = {
+	"service", "handler", "client", "manager", "pool", "store", "controller",
+	"worker", "sync", "router"
+};
+
+static const char *const actions[] = {
+	"edit", "items", "status", "history", "settings", "export"
+};
+
+static const char *const host_roles[] = {
+	"web", "app", "db", "cache", "worker"
+};
+
+static const char *const first_names[] = {
+	"alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi",
+	"ivan", "judy", "mallory", "nia", "oscar", "peggy", "rupert", "sybil",
+	"trent", "victor", "walter", "yuki"
+};
+
+static const char *const words[] = {
+	"request", "completed", "started", "connection", "failed", "timeout",
+	"retry", "user", "cache", "miss", "hit", "session", "created", "closed",
+	"expired", "invalid", "token", "received", "sent", "message", "queue",
+	"processing", "job", "finished", "error", "warning", "loaded", "config",
+	"updated", "deleted", "record", "not", "found", "opened", "file", "write",
+	"read", "slow", "query", "database", "transaction", "committed",
+	"rolled", "back", "lock", "acquired", "released", "payment", "order",
+	"accepted", "rejected", "scheduled", "task", "worker", "shutdown",
+	"listening", "on", "port", "health", "check", "ok", "degraded", "the", "for"
+};
+
+enum log_field {
+	FIELD_TEXT,
+	FIELD_TIME_ISO,
+	FIELD_TIME_CLF,
+	FIELD_TIME_SYSLOG,
+	FIELD_TIME_EPOCH,
+	FIELD_DICT,
+	FIELD_ID,
+	FIELD_UUID,
+	FIELD_INT,
+	FIELD_MS
+};
+
+/* Operation of compiled template */
+struct log_op {
+	enum log_field field;
+	unsigned int dict;
+	uint64_t a; /**< Offset of text, or minimum of int */
+	uint64_t b; /**< Length of text, or range of int minus one */
+};
+
+struct log_template {
+	size_t first_op;
+	size_t num_ops;
+	size_t max_len;
+};
+
+struct log_model {
+	struct log_params params;
+	struct lzdg_dict dicts[NUM_DICTS];
+	struct lzdg_sampler ranks;
+	struct log_template templates[LOG_MAX_TEMPLATES];
+	size_t num_templates;
+	struct log_op *ops;
+	size_t num_ops;
+	unsigned char *text;
+	size_t text_size;
+	size_t max_line;
+	uint32_t ms_table[LOG_MS_SIZE];
+	uint64_t start_ms;
+	uint64_t window_ms;
+	uint64_t seed;
+};
+
+static const char month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+static unsigned char *
+emit_line(const struct log_model *m, struct rng_state *rng,
+          uint64_t ms, unsigned char *p)
+{
+	const struct log_template *t = &m->templates[lzdg_sample(&m->ranks, rng_next32(rng))];
+	const struct log_op *op = m->ops + t->first_op;
+	const struct log_op *op_end = op + t->num_ops;
+	struct lzdg_tm tm;
+
+	for (; op < op_end; ++op) {
+		switch (op->field) {
+		case FIELD_TEXT:
+			memcpy(p, m->text + op->a, (size_t) op->b);
+			p += op->b;
+			break;
+		case FIELD_TIME_ISO:
+			/* 2023-01-01T00:00:00.000Z */
+			lzdg_gmtime(ms, &tm);
+			p = lzdg_put_date(p, &tm);
+			*p++ = 'T';
+			p = lzdg_put_clock(p, &tm);
+			*p++ = '.';
+			*p++ = (unsigned char) ('0' + tm.ms / 100);
+			p = lzdg_put2(p, tm.ms % 100);
+			*p++ = 'Z';
+			break;
+		case FIELD_TIME_CLF:
+			/* 01/Jan/2023:00:00:00 +0000 */
+			lzdg_gmtime(ms, &tm);
+			p = lzdg_put2(p, tm.day);
+			*p++ = '/';
+			memcpy(p, &month_names[3 * (tm.mon - 1)], 3);
+			p += 3;
+			*p++ = '/';
+			p = lzdg_put2(p, tm.year / 100 % 100);
+			p = lzdg_put2(p, tm.year % 100);
+			*p++ = ':';
+			p = lzdg_put_clock(p, &tm);
+			memcpy(p, " +0000", 6);
+			p += 6;
+			break;
+		case FIELD_TIME_SYSLOG:
+			/* Jan  1 00:00:00 */
+			lzdg_gmtime(ms, &tm);
+			memcpy(p, &month_names[3 * (tm.mon - 1)], 3);
+			p[3] = ' ';
+			p += 4;
+			if (tm.day < 10) {
+				*p++ = ' ';
+				*p++ = (unsigned char) ('0' + tm.day);
+			}
+			else {
+				p = lzdg_put2(p, tm.day);
+			}
+			*p++ = ' ';
+			p = lzdg_put_clock(p, &tm);
+			break;
+		case FIELD_TIME_EPOCH:
+			/* 1672531200.000 */
+			p = lzdg_format_uint(p, ms / 1000);
+			*p++ = '.';
+			*p++ = (unsigned char) ('0' + ms % 1000 / 100);
+			p = lzdg_put2(p, (uint32_t) (ms % 100));
+			break;
+		case FIELD_DICT: {
+			const struct lzdg_dict *d = &m->dicts[op->dict];
+
+			p = lzdg_dict_emit(d, lzdg_sample(&d->ranks, rng_next32(rng)), p);
+			break;
+		}
+		case FIELD_ID:
+			p = lzdg_put_hex(p, rng_next64(rng), 16);
+			break;
+		case FIELD_UUID: {
+			/* Version 4, variant 1 */
+			uint64_t hi = rng_next64(rng);
+			uint64_t lo = rng_next64(rng);
+
+			p = lzdg_put_hex(p, hi >> 32, 8);
+			*p++ = '-';
+			p = lzdg_put_hex(p, hi >> 16, 4);
+			*p++ = '-';
+			p = lzdg_put_hex(p, (hi & 0x0FFF) | 0x4000, 4);
+			*p++ = '-';
+			p = lzdg_put_hex(p, ((lo >> 48) & 0x3FFF) | 0x8000, 4);
+			*p++ = '-';
+			p = lzdg_put_hex(p, lo, 12);
+			break;
+		}
+		case FIELD_INT: {
+			uint64_t v = rng_next64(rng);
+
+			if (op->b != UINT64_MAX) {
+				v %= op->b + 1;
+			}
+
+			p = lzdg_format_uint(p, op->a + v);
+			break;
+		}
+		case FIELD_MS:
+			p = lzdg_format_uint(p, m->ms_table[rng_next32(rng) >> (32 - LOG_MS_BITS)]);
+			break;
+		}
+	}
+
+	*p++ = '\n';
+
+	return p;
+}
+
+/* Append `len` bytes of text to template text, storing its offset in `offs` */
+static int
+add_text(struct log_model *m, const char *s, size_t len, uint64_t *offs)
+{
+	unsigned char *text = (unsigned char *) realloc(m->text, m->text_size + len + 1);
+
+	if (text == NULL) {
+		return 1;
+	}
+
+	m->text = text;
+
+	memcpy(m->text + m->text_size, s, len);
+
+	*offs = m->text_size;
+	m->text_size += len;
+
+	return 0;
+}
+
+static struct log_op *
+add_op(struct log_model *m, enum log_field field)
+{
+	struct log_op *ops = (struct log_op *) realloc(m->ops, (m->num_ops + 1) * sizeof(m->ops[0]));
+
+	if (ops == NULL) {
+		return NULL;
+	}
+
+	m->ops = ops;
+
+	ops[m->num_ops].field = field;
+	ops[m->num_ops].dict = 0;
+	ops[m->num_ops].a = 0;
+	ops[m->num_ops].b = 0;
+
+	return &ops[m->num_ops++];
+}
+
+/*
+ * Parse field `s` of length `len`, without braces, into `op`, and return
+ * its maximum length, or 0 on error.
+ */
+static size_t
+parse_field(struct log_model *m, const char *s, size_t len, struct log_op *op)
+{
+	char name[32];
+	const char *arg = (const char *) memchr(s, ':', len);
+	size_t name_len = arg != NULL ? (size_t) (arg - s) : len;
+	size_t i;
+
+	if (name_len >= sizeof(name)) {
+		return 0;
+	}
+
+	memcpy(name, s, name_len);
+	name[name_len] = '\0';
+
+	if (strcmp(name, "time") == 0) {
+		if (arg == NULL || (len - name_len == 4 && memcmp(arg, ":iso", 4) == 0)) {
+			op->field = FIELD_TIME_ISO;
+			return 24;
+		}
+		if (len - name_len == 4 && memcmp(arg, ":clf", 4) == 0) {
+			op->field = FIELD_TIME_CLF;
+			return 26;
+		}
+		if (len - name_len == 7 && memcmp(arg, ":syslog", 7) == 0) {
+			op->field = FIELD_TIME_SYSLOG;
+			return 15;
+		}
+		if (len - name_len == 6 && memcmp(arg, ":epoch", 6) == 0) {
+			op->field = FIELD_TIME_EPOCH;
+			return LZDG_UINT_DIGITS + 4;
+		}
+		return 0;
+	}
+
+	if (strcmp(name, "int") == 0) {
+		unsigned long long lo;
+		unsigned long long hi;
+		char buf[64];
+		char *ep = NULL;
+
+		if (arg == NULL || len - name_len >= sizeof(buf)) {
+			return 0;
+		}
+
+		memcpy(buf, arg + 1, len - name_len - 1);
+		buf[len - name_len - 1] = '\0';
+
+		lo = strtoull(buf, &ep, 10);
+
+		if (ep == buf || *ep != ':') {
+			return 0;
+		}
+
+		hi = strtoull(ep + 1, &ep, 10);
+
+		if (*ep != '\0' || hi < lo) {
+			return 0;
+		}
+
+		op->field = FIELD_INT;
+		op->a = lo;
+		op->b = hi - lo;
+
+		return LZDG_UINT_DIGITS;
+	}
+
+	if (arg != NULL) {
+		return 0;
+	}
+
+	if (strcmp(name, "id") == 0) {
+		op->field = FIELD_ID;
+		return 16;
+	}
+
+	if (strcmp(name, "uuid") == 0) {
+		op->field = FIELD_UUID;
+		return 36;
+	}
+
+	if (strcmp(name, "ms") == 0) {
+		op->field = FIELD_MS;
+		return LZDG_UINT_DIGITS;
+	}
+
+	for (i = 0; i < NUM_DICTS; ++i) {
+		if (strcmp(name, dict_names[i]) == 0) {
+			op->field = FIELD_DICT;
+			op->dict = (unsigned int) i;
+			return m->dicts[i].max_len;
+		}
+	}
+
+	return 0;
+}
+
+static int
+compile_template(struct log_model *m, const char *s, const char **error)
+{
+	struct log_template *t = &m->templates[m->num_templates];
+	size_t max_len = 1;
+
+	if (m->num_templates == LOG_MAX_TEMPLATES) {
+		*error = "log has too many templates";
+		return 1;
+	}
+
+	t->first_op = m->num_ops;
+
+	while (*s != '\0') {
+		struct log_op *op;
+		size_t len;
+		size_t skip;
+
+		if (*s == '{' && s[1] != '{') {
+			const char *end = strchr(s, '}');
+
+			if (end == NULL) {
+				*error = "log template has unterminated field";
+				return 1;
+			}
+
+			if ((op = add_op(m, FIELD_TEXT)) == NULL) {
+				*error = "out of memory";
+				return 1;
+			}
+
+			len = parse_field(m, s + 1, (size_t) (end - s - 1), op);
+
+			if (len == 0) {
+				*error = "log template has unknown field";
+				return 1;
+			}
+
+			max_len += len;
+			s = end + 1;
+
+			continue;
+		}
+
+		/* Text up to next brace, with {{ and }} as literal braces */
+		if ((*s == '{' || *s == '}') && s[1] == *s) {
+			len = 1;
+			skip = 2;
+		}
+		else {
+			len = 1 + strcspn(s + 1, "{}");
+			skip = len;
+		}
+
+		op = m->num_ops > t->first_op ? &m->ops[m->num_ops - 1] : NULL;
+
+		/* Extend previous text if possible, so it is copied at once */
+		if (op != NULL && op->field == FIELD_TEXT && op->a + op->b == m->text_size) {
+			uint64_t offs;
+
+			if (add_text(m, s, len, &offs)) {
+				*error = "out of memory";
+				return 1;
+			}
+		}
+		else if ((op = add_op(m, FIELD_TEXT)) == NULL || add_text(m, s, len, &op->a)) {
+			*error = "out of memory";
+			return 1;
+		}
+
+		op->b += len;
+		max_len += len;
+		s += skip;
+	}
+
+	if (max_len + LOG_SLACK > LOG_MAX_LINE) {
+		*error = "log template is too long";
+		return 1;
+	}
+
+	t->num_ops = m->num_ops - t->first_op;
+	t->max_len = max_len;
+
+	if (max_len + LOG_SLACK > m->max_line) {
+		m->max_line = max_len + LOG_SLACK;
+	}
+
+	m->num_templates++;
+
+	return 0;
+}
+
+static int
+load_templates(struct log_model *m, const char *file, const char **error)
+{
+	char line[LOG_MAX_LINE];
+	FILE *fp = fopen(file, "r");
+
+	if (fp == NULL) {
+		*error = "unable to open log templates file";
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+
+		if (compile_template(m, line, error)) {
+			fclose(fp);
+			return 1;
+		}
+	}
+
+	fclose(fp);
+
+	if (m->num_templates == 0) {
+		*error = "log templates file has no templates";
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Append string list `list` of `num` strings to `buf` */
+static char *
+put_list(char *buf, const char *const *list, size_t num)
+{
+	size_t i;
+
+	for (i = 0; i < num; ++i) {
+		size_t len = strlen(list[i]) + 1;
+
+		memcpy(buf, list[i], len);
+		buf += len;
+	}
+
+	return buf;
+}
+
+static int
+build_dicts(struct log_model *m, struct rng_state *rng)
+{
+	const struct log_params *params = &m->params;
+	size_t max_num = (size_t) params->clients;
+	char *buf;
+	char *q;
+	size_t i;
+	int res = 0;
+
+	if (params->users > max_num) {
+		max_num = (size_t) params->users;
+	}
+
+	if (params->paths > max_num) {
+		max_num = (size_t) params->paths;
+	}
+
+	if (params->hosts > max_num) {
+		max_num = (size_t) params->hosts;
+	}
+
+	/* Enough for all generated strings, which are at most 47 bytes */
+	buf = (char *) malloc((max_num + ARRAY_SIZE(components) * ARRAY_SIZE(roles)) * 48);
+
+	if (buf == NULL) {
+		return 1;
+	}
+
+	res |= lzdg_dict_init(&m->dicts[DICT_LEVEL], levels, ARRAY_SIZE(level_weights), level_weights, 0);
+	res |= lzdg_dict_init(&m->dicts[DICT_STATUS], statuses, ARRAY_SIZE(status_weights), status_weights, 0);
+	res |= lzdg_dict_init(&m->dicts[DICT_METHOD], methods, ARRAY_SIZE(method_weights), method_weights, 0);
+
+	put_list(buf, agents, ARRAY_SIZE(agents));
+	res |= lzdg_dict_init(&m->dicts[DICT_AGENT], buf, ARRAY_SIZE(agents), NULL, 1.0);
+
+	put_list(buf, words, ARRAY_SIZE(words));
+	res |= lzdg_dict_init(&m->dicts[DICT_WORD], buf, ARRAY_SIZE(words), NULL, params->zipf);
+
+	/* Modules are all pairs of component and role, in random order */
+	{
+		size_t num = ARRAY_SIZE(components) * ARRAY_SIZE(roles);
+		size_t order[ARRAY_SIZE(components) * ARRAY_SIZE(roles)];
+
+		for (i = 0; i < num; ++i) {
+			order[i] = i;
+		}
+
+		for (i = num - 1; i > 0; --i) {
+			size_t j = (size_t) (((uint64_t) rng_next32(rng) * (i + 1)) >> 32);
+			size_t tmp = order[i];
+
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+
+		for (i = 0, q = buf; i < num; ++i) {
+			q += sprintf(q, "%s.%s", components[order[i] / ARRAY_SIZE(roles)],
+			             roles[order[i] % ARRAY_SIZE(roles)]) + 1;
+		}
+
+		res |= lzdg_dict_init(&m->dicts[DICT_MODULE], buf, num, NULL, params->zipf);
+	}
+
+	for (i = 0, q = buf; i < params->hosts; ++i) {
+		q += sprintf(q, "%s-%02u", host_roles[i % ARRAY_SIZE(host_roles)],
+		             (unsigned int) (i / ARRAY_SIZE(host_roles) + 1)) + 1;
+	}
+
+	res |= lzdg_dict_init(&m->dicts[DICT_HOST], buf, (size_t) params->hosts, NULL, params->zipf);
+
+	for (i = 0, q = buf; i < params->clients; ++i) {
+		uint32_t v = rng_next32(rng);
+
+		q += sprintf(q, "%u.%u.%u.%u", 1 + (v >> 24) % 223, (v >> 16) & 0xFF,
+		             (v >> 8) & 0xFF, v & 0xFF) + 1;
+	}
+
+	res |= lzdg_dict_init(&m->dicts[DICT_IP], buf, (size_t) params->clients, NULL, params->zipf);
+
+	for (i = 0, q = buf; i < params->users; ++i) {
+		uint32_t v = rng_next32(rng);
+		const char *name = first_names[v % ARRAY_SIZE(first_names)];
+
+		if (i < ARRAY_SIZE(first_names)) {
+			q += sprintf(q, "%s", first_names[i]) + 1;
+		}
+		else {
+			q += sprintf(q, "%s%u", name, (unsigned int) (v >> 16) % 10000) + 1;
+		}
+	}
+
+	res |= lzdg_dict_init(&m->dicts[DICT_USER], buf, (size_t) params->users, NULL, params->zipf);
+
+	for (i = 0, q = buf; i < params->paths; ++i) {
+		uint32_t v = rng_next32(rng);
+		const char *res_name = components[v % ARRAY_SIZE(components)];
+
+		switch ((v >> 8) & 3) {
+		case 0:
+			q += sprintf(q, "/api/v1/%s", res_name) + 1;
+			break;
+		case 1:
+			q += sprintf(q, "/api/v1/%s/%u", res_name, (unsigned int) (v >> 12) % 100000) + 1;
+			break;
+		case 2:
+			q += sprintf(q, "/api/v1/%s/%u/%s", res_name, (unsigned int) (v >> 12) % 100000,
+			             actions[(v >> 4) % ARRAY_SIZE(actions)]) + 1;
+			break;
+		default:
+			q += sprintf(q, "/static/%s/%s.js", res_name, roles[(v >> 12) % ARRAY_SIZE(roles)]) + 1;
+			break;
+		}
+	}
+
+	res |= lzdg_dict_init(&m->dicts[DICT_PATH], buf, (size_t) params->paths, NULL, params->zipf);
+
+	free(buf);
+
+	return res;
+}
+
+static void
+log_destroy(void *state)
+{
+	struct log_model *m = (struct log_model *) state;
+	size_t i;
+
+	if (m == NULL) {
+		return;
+	}
+
+	for (i = 0; i < NUM_DICTS; ++i) {
+		lzdg_dict_free(&m->dicts[i]);
+	}
+
+	lzdg_sampler_free(&m->ranks);
+	free(m->text);
+	free(m->ops);
+	free(m);
+}
+
+static void *
+log_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct log_params params = { 0, NULL, 1000.0, 1672531200, 50.0, 1000, 1000, 200, 16, 1.0 };
+	struct log_model *m;
+	struct rng_state rng;
+	unsigned char *sample;
+	size_t sample_size = 0;
+	size_t i;
+
+	if (lzdg_parse_options(log_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	m = (struct log_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->params = params;
+	m->seed = seed;
+	m->start_ms = params.start * 1000;
+
+	/* Templates file name is not kept */
+	m->params.templates = NULL;
+
+	rng_seed(&rng, seed ^ UINT64_C(0x9E3779B97F4A7C15));
+
+	if (build_dicts(m, &rng)) {
+		log_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	if (params.templates != NULL) {
+		if (load_templates(m, params.templates, error)) {
+			log_destroy(m);
+			return NULL;
+		}
+	}
+	else {
+		const char *const *t = builtin_templates[params.format];
+
+		for (i = 0; t[i] != NULL; ++i) {
+			if (compile_template(m, t[i], error)) {
+				log_destroy(m);
+				return NULL;
+			}
+		}
+	}
+
+	if (lzdg_sampler_init_zipf(&m->ranks, m->num_templates, 1.0)) {
+		log_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	/* Latencies are exponentially distributed */
+	for (i = 0; i < LOG_MS_SIZE; ++i) {
+		m->ms_table[i] = (uint32_t) (-params.latency * log(1.0 - (i + 0.5) / LOG_MS_SIZE));
+	}
+
+	/* Estimate mean line length to find the time covered by a block */
+	sample = (unsigned char *) malloc(m->max_line);
+
+	if (sample == NULL) {
+		log_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	for (i = 0; i < LOG_SAMPLE_LINES; ++i) {
+		sample_size += (size_t) (emit_line(m, &rng, m->start_ms, sample) - sample);
+	}
+
+	free(sample);
+
+	m->window_ms = (uint64_t) (1000.0 * LZDG_NOMINAL_BLOCK * LOG_SAMPLE_LINES / sample_size / params.rate);
+
+	if (m->window_ms == 0) {
+		m->window_ms = 1;
+	}
+
+	return m;
+}
+
+static void
+log_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct log_model *m = (const struct log_model *) state;
+	unsigned char line[LOG_MAX_LINE];
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	uint64_t block_ms = m->start_ms + index * m->window_ms;
+	double ms_per_byte = (double) m->window_ms / size;
+	struct rng_state rng;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	/* Lines are spread evenly over the time window of the block */
+	while ((size_t) (end - p) >= m->max_line) {
+		p = emit_line(m, &rng, block_ms + (uint64_t) ((p - ptr) * ms_per_byte), p);
+	}
+
+	/* The block ends with the last line that fits, padded with spaces */
+	for (;;) {
+		uint64_t ms = block_ms + (uint64_t) ((p - ptr) * ms_per_byte);
+		size_t len = (size_t) (emit_line(m, &rng, ms, line) - line);
+
+		if (len > (size_t) (end - p)) {
+			break;
+		}
+
+		memcpy(p, line, len);
+		p += len;
+	}
+
+	lzdg_pad_lines(ptr, p, end);
+}
+
+const struct lzdg_model_type lzdg_log_model = {
+	"log",
+	"log lines from templates with timestamps, levels and IDs",
+	log_create,
+	log_generate,
+	log_destroy
+};
@@ -0,0 +1,476 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Registry of model types, and helpers shared by the models.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Scale of sampler cumulative distributions */
+#define SAMPLER_BITS 31
+#define SAMPLER_ONE (UINT32_C(1) << SAMPLER_BITS)
+
+/* Maximum size of sampler guide tables, as a power of 2 */
+#define MAX_GUIDE_BITS 16
+
+struct lzdg_model {
+	const struct lzdg_model_type *type;
+	void *state;
+};
+
+static const struct lzdg_model_type *const model_types[] = {
+	&lzdg_text_model,
+	&lzdg_log_model,
+	&lzdg_json_model,
+	&lzdg_table_model,
+	&lzdg_int_model,
+	&lzdg_float_model,
+	&lzdg_stride_model
+};
+
+#define NUM_MODEL_TYPES (sizeof(model_types) / sizeof(model_types[0]))
+
+const char lzdg_digit_pairs[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static int
+parse_option_value(const struct lzdg_option *def, void *dst, const char *value)
+{
+	switch (def->kind) {
+	case LZDG_OPT_UINT: {
+		char *endp = NULL;
+		unsigned long long v;
+
+		if (*value < '0' || *value > '9') {
+			return 1;
+		}
+
+		errno = 0;
+
+		v = strtoull(value, &endp, 0);
+
+		if (errno != 0 || *endp != '\0'
+		 || (double) v < def->min || (double) v > def->max) {
+			return 1;
+		}
+
+		*(uint64_t *) dst = (uint64_t) v;
+
+		return 0;
+	}
+	case LZDG_OPT_DOUBLE: {
+		char *endp = NULL;
+		double v;
+
+		v = strtod(value, &endp);
+
+		if (endp == value || *endp != '\0' || !(v >= def->min && v <= def->max)) {
+			return 1;
+		}
+
+		*(double *) dst = v;
+
+		return 0;
+	}
+	case LZDG_OPT_ENUM: {
+		const char *name = def->names;
+		size_t value_len = strlen(value);
+		unsigned int i;
+
+		for (i = 0; *name != '\0'; ++i) {
+			size_t name_len = strcspn(name, ",");
+
+			if (name_len == value_len && strncmp(name, value, name_len) == 0) {
+				*(unsigned int *) dst = i;
+
+				return 0;
+			}
+
+			name += name_len;
+
+			if (*name == ',') {
+				++name;
+			}
+		}
+
+		return 1;
+	}
+	case LZDG_OPT_STRING:
+		*(const char **) dst = value;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+int
+lzdg_parse_options(const struct lzdg_option *defs, void *params,
+                   const char *const *options, size_t num_options,
+                   const char **error)
+{
+	size_t i;
+
+	for (i = 0; i < num_options; ++i) {
+		const char *value = strchr(options[i], '=');
+		const struct lzdg_option *def;
+		size_t key_len;
+
+		if (value == NULL) {
+			*error = "option must be of the form KEY=VALUE";
+			return 1;
+		}
+
+		key_len = (size_t) (value - options[i]);
+
+		for (def = defs; def->name != NULL; ++def) {
+			if (strlen(def->name) == key_len
+			 && strncmp(def->name, options[i], key_len) == 0) {
+				break;
+			}
+		}
+
+		if (def->name == NULL) {
+			*error = "unknown option for model type";
+			return 1;
+		}
+
+		if (parse_option_value(def, (char *) params + def->offset, value + 1)) {
+			*error = def->error;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int
+lzdg_sampler_init(struct lzdg_sampler *s, const double *weights, size_t n)
+{
+	double total = 0.0;
+	double sum = 0.0;
+	unsigned int guide_bits = 0;
+	size_t num_guide;
+	size_t i;
+	size_t r;
+
+	s->cdf = NULL;
+	s->guide = NULL;
+
+	for (i = 0; i < n; ++i) {
+		total += weights[i];
+	}
+
+	if (n == 0 || n > SAMPLER_ONE || !(total > 0.0)) {
+		return 1;
+	}
+
+	while (guide_bits < MAX_GUIDE_BITS && (size_t) 1 << guide_bits < n) {
+		++guide_bits;
+	}
+
+	num_guide = (size_t) 1 << guide_bits;
+
+	s->cdf = (uint32_t *) malloc(n * sizeof(s->cdf[0]));
+	s->guide = (uint32_t *) malloc(num_guide * sizeof(s->guide[0]));
+	s->guide_shift = SAMPLER_BITS - guide_bits;
+
+	if (s->cdf == NULL || s->guide == NULL) {
+		lzdg_sampler_free(s);
+		return 1;
+	}
+
+	for (i = 0; i < n; ++i) {
+		sum += weights[i];
+
+		s->cdf[i] = (uint32_t) (sum / total * SAMPLER_ONE + 0.5);
+
+		if (s->cdf[i] > SAMPLER_ONE) {
+			s->cdf[i] = SAMPLER_ONE;
+		}
+	}
+
+	/* Make sure every 31-bit value is inside the distribution */
+	s->cdf[n - 1] = SAMPLER_ONE;
+
+	for (i = 0, r = 0; i < num_guide; ++i) {
+		uint32_t lower = (uint32_t) (i << s->guide_shift);
+
+		while (s->cdf[r] <= lower) {
+			++r;
+		}
+
+		s->guide[i] = (uint32_t) r;
+	}
+
+	return 0;
+}
+
+int
+lzdg_sampler_init_zipf(struct lzdg_sampler *s, size_t n, double exponent)
+{
+	double *weights;
+	size_t i;
+	int res;
+
+	weights = (double *) malloc((n ? n : 1) * sizeof(weights[0]));
+
+	if (weights == NULL) {
+		s->cdf = NULL;
+		s->guide = NULL;
+		return 1;
+	}
+
+	for (i = 0; i < n; ++i) {
+		weights[i] = pow((double) (i + 1), -exponent);
+	}
+
+	res = lzdg_sampler_init(s, weights, n);
+
+	free(weights);
+
+	return res;
+}
+
+void
+lzdg_sampler_free(struct lzdg_sampler *s)
+{
+	free(s->guide);
+	free(s->cdf);
+
+	s->guide = NULL;
+	s->cdf = NULL;
+}
+
+int
+lzdg_dict_init(struct lzdg_dict *d, const char *words, size_t num,
+               const double *weights, double exponent)
+{
+	const char *s = words;
+	size_t size = 0;
+	size_t i;
+	int res;
+
+	d->offs = NULL;
+	d->arena = NULL;
+	d->num = num;
+	d->max_len = 0;
+
+	for (i = 0; i < num; ++i) {
+		size_t len = strlen(s);
+
+		size += len;
+		s += len + 1;
+
+		if (len > d->max_len) {
+			d->max_len = len;
+		}
+	}
+
+	if (size > UINT32_MAX) {
+		return 1;
+	}
+
+	if (weights != NULL) {
+		res = lzdg_sampler_init(&d->ranks, weights, num);
+	}
+	else {
+		res = lzdg_sampler_init_zipf(&d->ranks, num, exponent);
+	}
+
+	if (res) {
+		return 1;
+	}
+
+	d->offs = (uint32_t *) malloc((num + 1) * sizeof(d->offs[0]));
+	d->arena = (unsigned char *) calloc(size + LZDG_DICT_PAD, 1);
+
+	if (d->offs == NULL || d->arena == NULL) {
+		lzdg_dict_free(d);
+		return 1;
+	}
+
+	for (i = 0, s = words, size = 0; i < num; ++i) {
+		size_t len = strlen(s);
+
+		d->offs[i] = (uint32_t) size;
+
+		memcpy(d->arena + size, s, len);
+
+		size += len;
+		s += len + 1;
+	}
+
+	d->offs[num] = (uint32_t) size;
+
+	return 0;
+}
+
+void
+lzdg_dict_free(struct lzdg_dict *d)
+{
+	lzdg_sampler_free(&d->ranks);
+	free(d->arena);
+	free(d->offs);
+
+	d->arena = NULL;
+	d->offs = NULL;
+}
+
+char *
+lzdg_build_words(struct rng_state *rng, char *buf, size_t num)
+{
+	static const char consonants[] = "bcdfghklmnprstvwz";
+	static const char vowels[] = "aeiou";
+	char *q = buf;
+	size_t i;
+	size_t j;
+
+	for (i = 0; i < num; ++i) {
+		size_t len = LZDG_MIN_WORD_LEN + lzdg_uniform(rng, LZDG_MAX_WORD_LEN - LZDG_MIN_WORD_LEN + 1);
+		uint32_t vowel = lzdg_uniform(rng, 2);
+
+		for (j = 0; j < len; ++j, vowel ^= 1) {
+			*q++ = vowel ? vowels[lzdg_uniform(rng, sizeof(vowels) - 1)]
+			             : consonants[lzdg_uniform(rng, sizeof(consonants) - 1)];
+		}
+
+		*q++ = '\0';
+	}
+
+	return q;
+}
+
+/*
+ * Based on `civil_from_days` by Howard Hinnant, for days since 1970.
+ */
+void
+lzdg_gmtime(uint64_t ms, struct lzdg_tm *tm)
+{
+	uint64_t secs = ms / 1000;
+	uint64_t z = secs / 86400 + 719468;
+	uint64_t era = z / 146097;
+	uint64_t doe = z - era * 146097;
+	uint64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint64_t mp = (5 * doy + 2) / 153;
+	uint32_t mon = (uint32_t) (mp < 10 ? mp + 3 : mp - 9);
+	uint32_t sod = (uint32_t) (secs % 86400);
+
+	tm->year = (uint32_t) (yoe + era * 400 + (mon <= 2));
+	tm->mon = mon;
+	tm->day = (uint32_t) (doy - (153 * mp + 2) / 5 + 1);
+	tm->hour = sod / 3600;
+	tm->min = sod / 60 % 60;
+	tm->sec = sod % 60;
+	tm->ms = (uint32_t) (ms % 1000);
+}
+
+const char *
+lzdg_model_type(size_t i)
+{
+	return i < NUM_MODEL_TYPES ? model_types[i]->name : NULL;
+}
+
+const char *
+lzdg_model_description(size_t i)
+{
+	return i < NUM_MODEL_TYPES ? model_types[i]->description : NULL;
+}
+
+struct lzdg_model *
+lzdg_model_create(const char *type, const char *const *options, size_t num_options,
+                  uint64_t seed, const char **error)
+{
+	const char *dummy_error = NULL;
+	struct lzdg_model *model;
+	size_t i;
+
+	if (error == NULL) {
+		error = &dummy_error;
+	}
+
+	for (i = 0; i < NUM_MODEL_TYPES; ++i) {
+		if (strcmp(model_types[i]->name, type) == 0) {
+			break;
+		}
+	}
+
+	if (i == NUM_MODEL_TYPES) {
+		*error = "unknown model type";
+		return NULL;
+	}
+
+	model = (struct lzdg_model *) malloc(sizeof(*model));
+
+	if (model == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	model->type = model_types[i];
+	model->state = model->type->create(options, num_options, seed, error);
+
+	if (model->state == NULL) {
+		free(model);
+		return NULL;
+	}
+
+	return model;
+}
+
+void
+lzdg_model_generate(const struct lzdg_model *model, void *ptr, size_t size, uint64_t index)
+{
+	if (size == 0) {
+		return;
+	}
+
+	model->type->generate(model->state, (unsigned char *) ptr, size, index);
+}
+
+void
+lzdg_model_destroy(struct lzdg_model *model)
+{
+	if (model == NULL) {
+		return;
+	}
+
+	model->type->destroy(model->state);
+
+	free(model);
+}
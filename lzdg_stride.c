@@ -0,0 +1,266 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Stride model.
+ *
+ * Arrays of fixed-size elements, where each byte lane, the byte at a given
+ * offset in every element, has its own entropy and correlation with the
+ * previous element. This is the structure byte shuffle and delta filters
+ * are designed for. Elements are generated a batch at a time, one lane at
+ * a time.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum number of bytes in an element */
+#define STRIDE_MAX_SIZE 64
+
+/* Number of elements in a batch */
+#define STRIDE_BATCH 256
+
+struct stride_params {
+	uint64_t size;
+	const char *entropy;
+	const char *corr;
+};
+
+static const struct lzdg_option stride_options[] = {
+	{ "size", LZDG_OPT_UINT, offsetof(struct stride_params, size), 1, STRIDE_MAX_SIZE, NULL,
+	  "stride size must be 1 to 64 bytes" },
+	{ "entropy", LZDG_OPT_STRING, offsetof(struct stride_params, entropy), 0, 0, NULL,
+	  "stride entropy must be a list of bits per lane" },
+	{ "corr", LZDG_OPT_STRING, offsetof(struct stride_params, corr), 0, 0, NULL,
+	  "stride corr must be a list of probabilities per lane" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+struct stride_model {
+	size_t size;
+	unsigned char base[STRIDE_MAX_SIZE]; /**< Value of lane with no entropy */
+	unsigned char mask[STRIDE_MAX_SIZE]; /**< Mask of random bits of lane */
+	uint32_t keep[STRIDE_MAX_SIZE];      /**< Probability of repeat, scaled to 2^16 */
+	uint64_t seed;
+};
+
+/*
+ * Parse comma-separated list of numbers from `min` to `max` into `values`,
+ * which must be integers if `whole` is set. Lanes past the end of the list
+ * get the last value, and values past the last lane are checked but not
+ * used.
+ */
+static int
+parse_lanes(const char *s, double min, double max, int whole, double *values, size_t num)
+{
+	size_t i = 0;
+
+	for (;;) {
+		char *endp = NULL;
+		double v;
+
+		errno = 0;
+
+		v = strtod(s, &endp);
+
+		if (endp == s || errno != 0 || !(v >= min && v <= max)
+		 || (whole && v != (double) (unsigned int) v)) {
+			return 1;
+		}
+
+		if (i < num) {
+			values[i++] = v;
+		}
+
+		if (*endp == '\0') {
+			break;
+		}
+
+		if (*endp != ',') {
+			return 1;
+		}
+
+		s = endp + 1;
+	}
+
+	for (; i < num; ++i) {
+		values[i] = values[i - 1];
+	}
+
+	return 0;
+}
+
+static void
+stride_destroy(void *state)
+{
+	free(state);
+}
+
+static void *
+stride_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct stride_params params = { 8, "8,6,4,2,0", "0" };
+	double entropy[STRIDE_MAX_SIZE];
+	double corr[STRIDE_MAX_SIZE];
+	struct stride_model *m;
+	struct rng_state rng;
+	size_t i;
+
+	if (lzdg_parse_options(stride_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	if (parse_lanes(params.entropy, 0, 8, 1, entropy, (size_t) params.size)) {
+		*error = "stride entropy must be a list of whole numbers of bits, 0 to 8, for each lane";
+		return NULL;
+	}
+
+	if (parse_lanes(params.corr, 0, 1, 0, corr, (size_t) params.size)) {
+		*error = "stride corr must be a list of 0.0 to 1.0 for each lane";
+		return NULL;
+	}
+
+	m = (struct stride_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->size = (size_t) params.size;
+	m->seed = seed;
+
+	rng_seed(&rng, seed ^ UINT64_C(0x9E3779B97F4A7C15));
+
+	for (i = 0; i < m->size; ++i) {
+		unsigned int bits = (unsigned int) entropy[i];
+
+		m->base[i] = (unsigned char) rng_next32(&rng);
+		m->mask[i] = (unsigned char) ((1U << bits) - 1);
+		m->keep[i] = (uint32_t) (corr[i] * 65536.0 + 0.5);
+	}
+
+	return m;
+}
+
+/*
+ * Generate lane `lane` of a batch of elements at `buf`, continuing from the
+ * byte `prev` of the previous element.
+ */
+static unsigned char
+fill_lane(const struct stride_model *m, struct rng_state *rng, unsigned char *buf,
+          size_t lane, unsigned char prev)
+{
+	unsigned char base = m->base[lane];
+	unsigned char mask = m->mask[lane];
+	uint32_t keep = m->keep[lane];
+	size_t size = m->size;
+	size_t j;
+
+	if (keep == 0) {
+		for (j = 0; j < STRIDE_BATCH; j += 8) {
+			uint64_t r = rng_next64(rng);
+			size_t k;
+
+			for (k = 0; k < 8; ++k, r >>= 8) {
+				buf[(j + k) * size] = (unsigned char) (base ^ (r & mask));
+			}
+		}
+
+		return buf[(STRIDE_BATCH - 1) * size];
+	}
+
+	/*
+	 * Each element takes 16 bits to decide to repeat, and a byte for the
+	 * value. The choice is made with a mask, since it is unpredictable.
+	 */
+	for (j = 0; j < STRIDE_BATCH; j += 8) {
+		uint64_t v = rng_next64(rng);
+		size_t h;
+
+		for (h = 0; h < 8; h += 4) {
+			uint64_t r = rng_next64(rng);
+			size_t k;
+
+			for (k = 0; k < 4; ++k, r >>= 16, v >>= 8) {
+				unsigned char fresh = (unsigned char) (base ^ (v & mask));
+				unsigned char sel = (unsigned char) (0U - ((r & 0xFFFF) >= keep));
+
+				prev = (unsigned char) ((fresh & sel) | (prev & ~sel));
+
+				buf[(j + h + k) * size] = prev;
+			}
+		}
+	}
+
+	return prev;
+}
+
+static void
+stride_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct stride_model *m = (const struct stride_model *) state;
+	unsigned char buf[STRIDE_BATCH * STRIDE_MAX_SIZE];
+	unsigned char prev[STRIDE_MAX_SIZE];
+	size_t batch_size = STRIDE_BATCH * m->size;
+	uint64_t offs = index * LZDG_NOMINAL_BLOCK;
+	size_t skip = (size_t) (offs % m->size);
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	struct rng_state rng;
+	size_t i;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	memcpy(prev, m->base, m->size);
+
+	while (p < end) {
+		size_t len;
+
+		for (i = 0; i < m->size; ++i) {
+			prev[i] = fill_lane(m, &rng, buf + i, i, prev[i]);
+		}
+
+		len = batch_size - skip;
+
+		if (len > (size_t) (end - p)) {
+			len = (size_t) (end - p);
+		}
+
+		memcpy(p, buf + skip, len);
+		p += len;
+
+		skip = 0;
+	}
+}
+
+const struct lzdg_model_type lzdg_stride_model = {
+	"stride",
+	"arrays of multi-byte elements with per-lane entropy and correlation",
+	stride_create,
+	stride_generate,
+	stride_destroy
+};
@@ -0,0 +1,738 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Table model.
+ *
+ * Rows of typed columns, written as CSV, TSV or fixed-width binary
+ * records. Values are generated a batch of rows at a time, one column at a
+ * time, so each column is a tight loop over its own type, and the batch is
+ * then interleaved into rows.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum number of columns */
+#define TABLE_MAX_COLUMNS 64
+
+/* Maximum number of bytes in a row */
+#define TABLE_MAX_ROW 8192
+
+/* Maximum number of rows in a batch */
+#define TABLE_MAX_BATCH 256
+
+/* Size of workspace for a batch, in bytes */
+#define TABLE_WORK_SIZE (64 * 1024)
+
+/* Exponents of LZ data for strings, the lzdgen defaults */
+#define STR_LEN_EXP 3.0
+#define STR_LIT_EXP 3.0
+
+enum table_format {
+	FORMAT_CSV,
+	FORMAT_TSV,
+	FORMAT_BINARY
+};
+
+enum column_type {
+	COL_ID,
+	COL_INT,
+	COL_CAT,
+	COL_DATE,
+	COL_TIME,
+	COL_FLOAT,
+	COL_STR
+};
+
+struct table_params {
+	unsigned int format;
+	const char *columns;
+	uint64_t header;
+	uint64_t start;
+	double zipf;
+};
+
+static const struct lzdg_option table_options[] = {
+	{ "format", LZDG_OPT_ENUM, offsetof(struct table_params, format), 0, 0, "csv,tsv,binary",
+	  "table format must be csv, tsv or binary" },
+	{ "columns", LZDG_OPT_STRING, offsetof(struct table_params, columns), 0, 0, NULL,
+	  "table columns must be a list of column types" },
+	{ "header", LZDG_OPT_UINT, offsetof(struct table_params, header), 0, 1, NULL,
+	  "table header must be 0 or 1" },
+	{ "start", LZDG_OPT_UINT, offsetof(struct table_params, start), 0, 4102444800.0, NULL,
+	  "table start must be 0 to 4102444800 seconds" },
+	{ "zipf", LZDG_OPT_DOUBLE, offsetof(struct table_params, zipf), 0, 4, NULL,
+	  "table zipf must be 0.0 to 4.0" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+static const char default_columns[] = "id,date,cat:8,cat:200,int:100000,float:2,str:24";
+
+/*
+ * Column types, with the defaults and limits of their arguments, like
+ * `float:DECIMALS:MAX`.
+ */
+static const struct {
+	const char *name;
+	double defaults[2];
+	double min[2];
+	double max[2];
+} column_types[] = {
+	{ "id", { 0, 0 }, { 0, 0 }, { 0, 0 } },
+	{ "int", { 1000000, 0 }, { 1, 0 }, { 1e18, 0 } },
+	{ "cat", { 16, 0 }, { 1, 0 }, { 1000000, 0 } },
+	{ "date", { 365, 0 }, { 1, 0 }, { 100000, 0 } },
+	{ "time", { 365, 0 }, { 1, 0 }, { 100000, 0 } },
+	{ "float", { 2, 1000 }, { 0, 1 }, { 9, 1e9 } },
+	{ "str", { 16, 3.0 }, { 1, 1 }, { 1024, 100 } }
+};
+
+/* Characters of strings, with the most frequent LZ literals first */
+static const char str_chars[64] =
+	"etaoinsrhldcumfpgwybvkxjqz ETAOINSRHLDCUMFPGWYBVKXJQZ0123456789-";
+
+struct table_column {
+	enum column_type type;
+	double args[2];
+	uint64_t range;        /**< Number of values of int, date, time and float */
+	uint64_t scale;        /**< 10^decimals of float */
+	uint64_t seed;         /**< Seed of LZ data of str */
+	struct lzdg_bulk *bulk; /**< Parameters of LZ data of str */
+	struct lzdg_dict dict; /**< Values of cat */
+	unsigned int width;    /**< Maximum number of bytes of a value */
+	unsigned int min_width;
+	size_t stride;         /**< Bytes per value in workspace */
+	size_t data;           /**< Offset of values in workspace */
+};
+
+struct table_model {
+	struct table_params params;
+	struct table_column cols[TABLE_MAX_COLUMNS];
+	size_t num_cols;
+	char *header;
+	size_t header_len;
+	size_t max_row;
+	size_t min_row;
+	size_t row_len;        /**< Length of binary rows */
+	uint64_t rows_per_block;
+	size_t batch;
+	size_t pad_col;        /**< Last str column, or `num_cols` if none */
+	unsigned char delim;
+	uint64_t start_day;
+	uint64_t seed;
+};
+
+static int
+parse_column(struct table_column *col, const char *s, size_t len)
+{
+	size_t name_len = strcspn(s, ":,");
+	size_t t;
+	int i;
+
+	if (name_len > len) {
+		name_len = len;
+	}
+
+	for (t = 0; t < ARRAY_SIZE(column_types); ++t) {
+		if (strlen(column_types[t].name) == name_len
+		 && strncmp(column_types[t].name, s, name_len) == 0) {
+			break;
+		}
+	}
+
+	if (t == ARRAY_SIZE(column_types)) {
+		return 1;
+	}
+
+	col->type = (enum column_type) t;
+	col->args[0] = column_types[t].defaults[0];
+	col->args[1] = column_types[t].defaults[1];
+
+	s += name_len;
+	len -= name_len;
+
+	for (i = 0; len > 0; ++i) {
+		char buf[32];
+		char *endp = NULL;
+		size_t arg_len = strcspn(s + 1, ":,");
+
+		if (arg_len > len - 1) {
+			arg_len = len - 1;
+		}
+
+		if (i == 2 || arg_len == 0 || arg_len >= sizeof(buf)
+		 || column_types[t].max[i] == 0) {
+			return 1;
+		}
+
+		memcpy(buf, s + 1, arg_len);
+		buf[arg_len] = '\0';
+
+		errno = 0;
+
+		col->args[i] = strtod(buf, &endp);
+
+		if (errno != 0 || *endp != '\0'
+		 || !(col->args[i] >= column_types[t].min[i] && col->args[i] <= column_types[t].max[i])) {
+			return 1;
+		}
+
+		s += arg_len + 1;
+		len -= arg_len + 1;
+	}
+
+	return 0;
+}
+
+static int
+build_categories(struct table_column *col, struct rng_state *rng, double zipf)
+{
+	size_t num = (size_t) col->args[0];
+	char *buf = (char *) malloc(num * (LZDG_MAX_WORD_LEN + 1));
+	int res;
+
+	if (buf == NULL) {
+		return 1;
+	}
+
+	lzdg_build_words(rng, buf, num);
+
+	res = lzdg_dict_init(&col->dict, buf, num, NULL, zipf);
+
+	free(buf);
+
+	return res;
+}
+
+/* Set up widths and ranges of `col` */
+static void
+setup_column(struct table_column *col, int binary)
+{
+	uint64_t decimals = (uint64_t) col->args[0];
+	uint64_t i;
+
+	switch (col->type) {
+	case COL_ID:
+		col->width = binary ? 8 : LZDG_UINT_DIGITS;
+		col->min_width = 1;
+		break;
+	case COL_INT:
+		col->range = (uint64_t) col->args[0] + 1;
+		col->width = binary ? (col->range <= UINT64_C(0x100000000) ? 4 : 8) : LZDG_UINT_DIGITS;
+		col->min_width = 1;
+		break;
+	case COL_CAT:
+		col->width = binary ? (col->dict.num <= 256 ? 1 : col->dict.num <= 65536 ? 2 : 4)
+		                    : (unsigned int) col->dict.max_len;
+		col->min_width = LZDG_MIN_WORD_LEN;
+		break;
+	case COL_DATE:
+		col->range = (uint64_t) col->args[0];
+		col->width = binary ? 4 : 10;
+		col->min_width = col->width;
+		break;
+	case COL_TIME:
+		col->range = (uint64_t) col->args[0] * 86400;
+		col->width = binary ? 8 : 19;
+		col->min_width = col->width;
+		break;
+	case COL_FLOAT:
+		for (i = 0, col->scale = 1; i < decimals; ++i) {
+			col->scale *= 10;
+		}
+		col->range = (uint64_t) col->args[1] * col->scale;
+		col->width = binary ? 8 : (unsigned int) (LZDG_UINT_DIGITS + 1 + decimals);
+		col->min_width = (unsigned int) (decimals ? decimals + 2 : 1);
+		break;
+	case COL_STR:
+		col->width = (unsigned int) col->args[0];
+		col->min_width = 1;
+		break;
+	}
+
+	col->stride = binary ? col->width : col->width + LZDG_DICT_PAD;
+}
+
+static void
+table_destroy(void *state)
+{
+	struct table_model *m = (struct table_model *) state;
+	size_t i;
+
+	if (m == NULL) {
+		return;
+	}
+
+	for (i = 0; i < m->num_cols; ++i) {
+		if (m->cols[i].type == COL_CAT) {
+			lzdg_dict_free(&m->cols[i].dict);
+		}
+
+		lzdg_bulk_free(m->cols[i].bulk);
+	}
+
+	free(m->header);
+	free(m);
+}
+
+static void *
+table_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct table_params params = { FORMAT_CSV, default_columns, 1, 1672531200, 1.0 };
+	struct table_model *m;
+	struct rng_state rng;
+	const char *s;
+	size_t row_work = 0;
+	char *q;
+	size_t i;
+
+	if (lzdg_parse_options(table_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	m = (struct table_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->params = params;
+	m->seed = seed;
+	m->delim = params.format == FORMAT_TSV ? '\t' : ',';
+	m->start_day = params.start / 86400;
+
+	/* Column list is not kept */
+	m->params.columns = NULL;
+
+	rng_seed(&rng, seed ^ UINT64_C(0x9E3779B97F4A7C15));
+
+	for (s = params.columns; ; ++s) {
+		struct table_column *col = &m->cols[m->num_cols];
+		size_t len = strcspn(s, ",");
+
+		if (m->num_cols == TABLE_MAX_COLUMNS) {
+			table_destroy(m);
+			*error = "table columns must be at most 64";
+			return NULL;
+		}
+
+		if (parse_column(col, s, len)) {
+			table_destroy(m);
+			*error = "table column must be id, int, cat, date, time, float or str, with valid arguments";
+			return NULL;
+		}
+
+		col->seed = rng_next64(&rng);
+
+		if (col->type == COL_CAT && build_categories(col, &rng, params.zipf)) {
+			table_destroy(m);
+			*error = "out of memory";
+			return NULL;
+		}
+
+		if (col->type == COL_STR
+		 && (col->bulk = lzdg_bulk_create(col->args[1], STR_LEN_EXP, STR_LIT_EXP)) == NULL) {
+			table_destroy(m);
+			*error = "out of memory";
+			return NULL;
+		}
+
+		m->num_cols++;
+
+		setup_column(col, params.format == FORMAT_BINARY);
+
+		m->max_row += col->width + 1;
+		m->min_row += col->min_width + 1;
+		row_work += col->stride + 2 * sizeof(uint32_t);
+
+		s += len;
+
+		if (*s == '\0') {
+			break;
+		}
+	}
+
+	if (m->max_row > TABLE_MAX_ROW) {
+		table_destroy(m);
+		*error = "table rows must be at most 8192 bytes";
+		return NULL;
+	}
+
+	/* Workspace also holds slack after the last value of each column */
+	m->batch = (TABLE_WORK_SIZE - m->num_cols * LZDG_DICT_PAD) / row_work;
+
+	if (m->batch > TABLE_MAX_BATCH) {
+		m->batch = TABLE_MAX_BATCH;
+	}
+
+	for (i = 0, row_work = 0; i < m->num_cols; ++i) {
+		m->cols[i].data = row_work;
+		row_work += m->batch * m->cols[i].stride + LZDG_DICT_PAD;
+	}
+
+	if (params.format == FORMAT_BINARY) {
+		m->row_len = m->max_row - m->num_cols;
+
+		return m;
+	}
+
+	for (i = 0, m->pad_col = m->num_cols; i < m->num_cols; ++i) {
+		if (m->cols[i].type == COL_STR) {
+			m->pad_col = i;
+		}
+	}
+
+	/* Lower bound on row length, so IDs of blocks do not overlap */
+	m->rows_per_block = LZDG_NOMINAL_BLOCK / m->min_row + 1;
+
+	if (!params.header) {
+		return m;
+	}
+
+	m->header = (char *) malloc(m->num_cols * 16);
+
+	if (m->header == NULL) {
+		table_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	for (i = 0, q = m->header; i < m->num_cols; ++i) {
+		if (m->cols[i].type == COL_ID) {
+			q += sprintf(q, "id%c", m->delim);
+		}
+		else {
+			q += sprintf(q, "%s_%u%c", column_types[m->cols[i].type].name, (unsigned int) i + 1, m->delim);
+		}
+	}
+
+	q[-1] = '\n';
+
+	m->header_len = (size_t) (q - m->header);
+
+	return m;
+}
+
+/*
+ * Generate `num` values of `col` for rows starting at `row`, storing them
+ * at `data`, and their positions and lengths in `pos` and `len`.
+ *
+ * Strings are generated from the LZ data of `batch_index` of the column.
+ */
+static void
+fill_column(const struct table_model *m, const struct table_column *col,
+            struct rng_state *rng, unsigned char *data, uint32_t *pos, uint32_t *len,
+            uint64_t row, size_t num, uint64_t batch_index)
+{
+	int binary = m->params.format == FORMAT_BINARY;
+	size_t r;
+
+	for (r = 0; r < num; ++r) {
+		pos[r] = (uint32_t) (r * col->stride);
+	}
+
+	switch (col->type) {
+	case COL_ID:
+		for (r = 0; r < num; ++r) {
+			unsigned char *q = data + pos[r];
+
+			if (binary) {
+				lzdg_put_le(q, row + r + 1, 8);
+			}
+			else {
+				len[r] = (uint32_t) (lzdg_format_uint(q, row + r + 1) - q);
+			}
+		}
+		break;
+	case COL_INT:
+		for (r = 0; r < num; ++r) {
+			unsigned char *q = data + pos[r];
+			uint64_t v = rng_next64(rng) % col->range;
+
+			if (binary) {
+				lzdg_put_le(q, v, col->width);
+			}
+			else {
+				len[r] = (uint32_t) (lzdg_format_uint(q, v) - q);
+			}
+		}
+		break;
+	case COL_CAT:
+		for (r = 0; r < num; ++r) {
+			unsigned char *q = data + pos[r];
+			size_t v = lzdg_sample(&col->dict.ranks, rng_next32(rng));
+
+			if (binary) {
+				lzdg_put_le(q, v, col->width);
+			}
+			else {
+				len[r] = (uint32_t) (lzdg_dict_emit(&col->dict, v, q) - q);
+			}
+		}
+		break;
+	case COL_DATE:
+		for (r = 0; r < num; ++r) {
+			unsigned char *q = data + pos[r];
+			uint64_t day = m->start_day + rng_next64(rng) % col->range;
+
+			if (binary) {
+				lzdg_put_le(q, day, 4);
+			}
+			else {
+				struct lzdg_tm tm;
+
+				lzdg_gmtime(day * 86400000, &tm);
+				len[r] = (uint32_t) (lzdg_put_date(q, &tm) - q);
+			}
+		}
+		break;
+	case COL_TIME:
+		for (r = 0; r < num; ++r) {
+			unsigned char *q = data + pos[r];
+			uint64_t secs = m->params.start + rng_next64(rng) % col->range;
+
+			if (binary) {
+				lzdg_put_le(q, secs, 8);
+			}
+			else {
+				struct lzdg_tm tm;
+				unsigned char *e;
+
+				lzdg_gmtime(secs * 1000, &tm);
+				e = lzdg_put_date(q, &tm);
+				*e++ = ' ';
+				len[r] = (uint32_t) (lzdg_put_clock(e, &tm) - q);
+			}
+		}
+		break;
+	case COL_FLOAT:
+		for (r = 0; r < num; ++r) {
+			unsigned char *q = data + pos[r];
+			uint64_t v = rng_next64(rng) % col->range;
+
+			if (binary) {
+				double d = (double) v / (double) col->scale;
+				uint64_t bits;
+
+				memcpy(&bits, &d, sizeof(bits));
+				lzdg_put_le(q, bits, 8);
+			}
+			else {
+				len[r] = (uint32_t) (lzdg_format_fixed(q, v, (unsigned int) col->args[0]) - q);
+			}
+		}
+		break;
+	case COL_STR: {
+		size_t size = num * col->width;
+		size_t offs = 0;
+		size_t i;
+
+		/*
+		 * Strings are consecutive slices of LZ data with the given ratio,
+		 * mapped to printable characters. Binary rows hold a slice padded
+		 * with zeros to the full width.
+		 */
+		lzdg_bulk_generate(col->bulk, data, size, col->seed, batch_index);
+
+		for (i = 0; i < size; ++i) {
+			data[i] = (unsigned char) str_chars[data[i] & 63];
+		}
+
+		for (r = 0; r < num; ++r) {
+			uint32_t n = 1 + lzdg_uniform(rng, col->width);
+
+			if (binary) {
+				memset(data + r * col->width + n, 0, col->width - n);
+			}
+			else {
+				pos[r] = (uint32_t) offs;
+				len[r] = n;
+				offs += n;
+			}
+		}
+
+		break;
+	}
+	}
+}
+
+/* Write row `r` of batch in `work` to `p` */
+static unsigned char *
+put_row(const struct table_model *m, const uint32_t *work, size_t r, unsigned char *p)
+{
+	const unsigned char *data = (const unsigned char *) (work + 2 * m->num_cols * m->batch);
+	size_t c;
+
+	if (m->params.format == FORMAT_BINARY) {
+		for (c = 0; c < m->num_cols; ++c) {
+			const struct table_column *col = &m->cols[c];
+
+			memcpy(p, data + col->data + r * col->width, col->width);
+			p += col->width;
+		}
+
+		return p;
+	}
+
+	for (c = 0; c < m->num_cols; ++c) {
+		const uint32_t *pos = work + 2 * c * m->batch;
+		uint32_t len = pos[m->batch + r];
+		const unsigned char *q = data + m->cols[c].data + pos[r];
+
+		if (len <= LZDG_DICT_PAD) {
+			memcpy(p, q, LZDG_DICT_PAD);
+		}
+		else {
+			memcpy(p, q, len);
+		}
+
+		p += len;
+		*p++ = m->delim;
+	}
+
+	p[-1] = '\n';
+
+	return p;
+}
+
+/*
+ * Fill the rest of a text block from `p` to `end`, where `last` is the start
+ * of the last row, or `NULL` if there is none. The row is padded with spaces
+ * at the end of its last str value, or before its newline if there is no
+ * str column, so the block ends on a row boundary.
+ */
+static void
+pad_text(const struct table_model *m, unsigned char *ptr, unsigned char *last,
+         unsigned char *p, unsigned char *end)
+{
+	size_t c;
+
+	if (last == NULL || m->pad_col == m->num_cols) {
+		lzdg_pad_lines(ptr, p, end);
+		return;
+	}
+
+	/* Values do not contain the delimiter */
+	for (c = 0; c < m->pad_col; ++c) {
+		last = (unsigned char *) memchr(last, m->delim, (size_t) (p - last)) + 1;
+	}
+
+	while (*last != m->delim && *last != '\n') {
+		last++;
+	}
+
+	lzdg_pad_at(last, p, end);
+}
+
+static void
+table_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct table_model *m = (const struct table_model *) state;
+	uint32_t work[TABLE_WORK_SIZE / sizeof(uint32_t)];
+	unsigned char tmp[TABLE_MAX_ROW + LZDG_DICT_PAD];
+	unsigned char *data = (unsigned char *) (work + 2 * m->num_cols * m->batch);
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	unsigned char *last = NULL;
+	uint64_t batch_index = index << 24;
+	struct rng_state rng;
+	size_t skip = 0;
+	size_t c;
+	uint64_t row;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	/*
+	 * Binary rows are placed as if all blocks were of nominal size, so a
+	 * block may start inside a row. Text blocks start with a new row.
+	 */
+	if (m->params.format == FORMAT_BINARY) {
+		uint64_t offs = index * LZDG_NOMINAL_BLOCK;
+
+		row = offs / m->row_len;
+		skip = (size_t) (offs % m->row_len);
+	}
+	else {
+		row = index * m->rows_per_block;
+
+		if (index == 0 && m->header_len > 0) {
+			size_t len = m->header_len < size ? m->header_len : size;
+
+			memcpy(p, m->header, len);
+			p += len;
+		}
+	}
+
+	while (p < end) {
+		size_t r;
+
+		for (c = 0; c < m->num_cols; ++c) {
+			uint32_t *pos = work + 2 * c * m->batch;
+
+			fill_column(m, &m->cols[c], &rng, data + m->cols[c].data,
+			            pos, pos + m->batch, row, m->batch, batch_index);
+		}
+
+		for (r = 0; r < m->batch && p < end; ++r) {
+			if (skip == 0 && (size_t) (end - p) >= m->max_row + LZDG_DICT_PAD) {
+				last = p;
+				p = put_row(m, work, r, p);
+			}
+			else {
+				size_t len = (size_t) (put_row(m, work, r, tmp) - tmp) - skip;
+
+				if (len <= (size_t) (end - p)) {
+					last = p;
+				}
+				else if (m->params.format != FORMAT_BINARY) {
+					pad_text(m, ptr, last, p, end);
+					return;
+				}
+				else {
+					len = (size_t) (end - p);
+				}
+
+				memcpy(p, tmp + skip, len);
+				p += len;
+				skip = 0;
+			}
+		}
+
+		row += m->batch;
+		batch_index++;
+	}
+}
+
+const struct lzdg_model_type lzdg_table_model = {
+	"table",
+	"rows of typed columns as CSV, TSV or binary records",
+	table_create,
+	table_generate,
+	table_destroy
+};
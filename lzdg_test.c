@@ -0,0 +1,969 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Statistical tests of the generation engines.
+ *
+ * lzdatagen.c is included, so the tests can use its internal functions and
+ * record the tokens of the generated data with LZDG_TRACE_TOKEN. The
+ * literals of the data, the lengths and the proportion of literal runs are
+ * compared to the distributions they should follow, with a chi-square or
+ * normal test at a fixed significance level. Seeds are fixed, so the tests
+ * give the same result on every run. The int test checks that sorted
+ * segments of the int model are sorted.
+ *
+ * Only the target_clones variant picked for the CPU is run, so lzdg-test is
+ * also built with LZDG_NO_TARGET_CLONES as lzdg-test-generic. With --digest
+ * it writes hashes of the data of fixed configurations to FILE, and with
+ * --compare lzdg-test checks that its data gives the same hashes.
+ *
+ * usage: lzdg-test [TEST]...
+ *        lzdg-test --digest FILE | --compare FILE
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
+#include <stddef.h>
+
+static void
+trace_token(int type, size_t len);
+
+#define LZDG_TRACE_TOKEN(type, len) trace_token((type), (len))
+
+#include "lzdatagen.c"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Seed of generated data */
+#define TEST_SEED UINT64_C(0x5EED1E55DA7A6E17)
+
+/* Number of bytes generated for each configuration */
+#define TEST_SIZE (16 * BLOCK_SIZE)
+
+/* Number of lengths generated for each configuration */
+#define TEST_LENGTHS (1UL << 20)
+
+/* Upper quantile of the standard normal distribution for significance 10^-4 */
+#define TEST_Z 3.719
+
+/* Least expected count of a bin in chi-square tests, smaller bins are merged */
+#define MIN_EXPECTED 5.0
+
+struct test_config {
+	double ratio;
+	double len_exp;
+	double lit_exp;
+};
+
+/* Tokens with both general and integer exponents, and uniform literals */
+static const struct test_config configs[] = {
+	{ 3.0, 3.0, 2.5 },
+	{ 2.0, 1.5, 3.0 },
+	{ 8.0, 2.0, 1.0 }
+};
+
+#define NUM_CONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+struct trace_entry {
+	size_t len;
+	int type;
+};
+
+/* Tokens recorded by trace_token while enabled */
+static struct {
+	struct trace_entry *tokens;
+	size_t num;
+	size_t cap;
+	int enabled;
+	int failed;
+} trace;
+
+static void
+trace_token(int type, size_t len)
+{
+	if (!trace.enabled) {
+		return;
+	}
+
+	if (trace.num == trace.cap) {
+		size_t cap = trace.cap ? 2 * trace.cap : 4096;
+		struct trace_entry *tokens = (struct trace_entry *) realloc(trace.tokens, cap * sizeof(*tokens));
+
+		if (tokens == NULL) {
+			trace.failed = 1;
+			return;
+		}
+
+		trace.tokens = tokens;
+		trace.cap = cap;
+	}
+
+	trace.tokens[trace.num].len = len;
+	trace.tokens[trace.num].type = type;
+	trace.num++;
+}
+
+static void
+trace_start(void)
+{
+	trace.num = 0;
+	trace.failed = 0;
+	trace.enabled = 1;
+}
+
+static void
+trace_stop(void)
+{
+	trace.enabled = 0;
+}
+
+/*
+ * Critical value of the chi-square distribution with `df` degrees of
+ * freedom at the significance of TEST_Z, by the Wilson-Hilferty
+ * approximation.
+ */
+static double
+chi_square_critical(double df)
+{
+	double h = 2.0 / (9.0 * df);
+	double t = 1.0 - h + TEST_Z * sqrt(h);
+
+	return df * t * t * t;
+}
+
+/*
+ * Chi-square test of the counts `observed` of `n` values against the
+ * probabilities `prob`. Adjacent values are merged into bins with an
+ * expected count of at least MIN_EXPECTED.
+ *
+ * @return 0 if the counts follow the distribution
+ */
+static int
+check_chi_square(const char *name, const unsigned long long *observed, const double *prob, size_t n)
+{
+	unsigned long long total = 0;
+	double stat = 0.0;
+	double o = 0.0;
+	double e = 0.0;
+	double critical;
+	size_t bins = 0;
+	size_t k;
+
+	for (k = 0; k < n; ++k) {
+		total += observed[k];
+	}
+
+	for (k = 0; k < n; ++k) {
+		if (prob[k] == 0.0 && observed[k] != 0) {
+			printf("  %s: value %u is not possible, but occurs %llu times\n",
+			       name, (unsigned int) k, observed[k]);
+			return 1;
+		}
+
+		o += (double) observed[k];
+		e += prob[k] * (double) total;
+
+		if (e >= MIN_EXPECTED || (k == n - 1 && e > 0.0)) {
+			stat += (o - e) * (o - e) / e;
+			bins++;
+			o = 0.0;
+			e = 0.0;
+		}
+	}
+
+	if (bins < 2) {
+		printf("  %s: too few samples\n", name);
+		return 1;
+	}
+
+	critical = chi_square_critical((double) (bins - 1));
+
+	printf("  %s: chi-square %.1f, df %u, critical %.1f\n",
+	       name, stat, (unsigned int) (bins - 1), critical);
+
+	return stat > critical;
+}
+
+/*
+ * Test that `count` of `trials` is a binomial sample with probability `p`.
+ *
+ * @return 0 if the count follows the distribution
+ */
+static int
+check_proportion(const char *name, size_t count, size_t trials, double p)
+{
+	double z = ((double) count - trials * p) / sqrt(trials * p * (1.0 - p));
+
+	printf("  %s: %.5f of %lu, expected %.5f, z %.2f\n",
+	       name, (double) count / trials, (unsigned long) trials, p, z);
+
+	return fabs(z) > TEST_Z;
+}
+
+/*
+ * Probabilities of the `n` values of `n * u^exp`, with `u` uniform in
+ * [0;1), which is the distribution of literals and lengths.
+ */
+static void
+power_probs(double *prob, size_t n, double exp)
+{
+	size_t k;
+
+	for (k = 0; k < n; ++k) {
+		prob[k] = pow((double) (k + 1) / n, 1.0 / exp) - pow((double) k / n, 1.0 / exp);
+	}
+}
+
+/* Probabilities of the `n` values of a table of `num_samples` samples */
+static void
+sample_probs(double *prob, size_t n, const unsigned char *samples, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		prob[i] = 0.0;
+	}
+
+	for (i = 0; i < num_samples; ++i) {
+		prob[samples[i]] += 1.0 / num_samples;
+	}
+}
+
+/*
+ * Check that the distribution of a table of samples is within one sample
+ * of the distribution of `n * u^exp`.
+ *
+ * @return 0 if the table follows the distribution
+ */
+static int
+check_samples(const char *name, const unsigned char *samples, size_t num_samples, size_t n, double exp)
+{
+	double max_dist = 0.0;
+	size_t count = 0;
+	size_t k;
+
+	for (k = 0; k < n; ++k) {
+		double dist;
+
+		while (count < num_samples && samples[count] <= k) {
+			if (count > 0 && samples[count] < samples[count - 1]) {
+				printf("  %s: samples are not sorted\n", name);
+				return 1;
+			}
+
+			count++;
+		}
+
+		dist = fabs((double) count / num_samples - pow((double) (k + 1) / n, 1.0 / exp));
+
+		if (dist > max_dist) {
+			max_dist = dist;
+		}
+	}
+
+	printf("  %s: distance %.2f samples\n", name, max_dist * num_samples);
+
+	return max_dist > 1.0 / num_samples;
+}
+
+/*
+ * Check the traced tokens of `data`. Every byte is covered by a token, and
+ * every match that follows a match in a block is preceded by one literal.
+ * Literals are counted for a chi-square test against `lit_prob`, and the
+ * lengths drawn for literal runs and matches for a test of the proportion of
+ * literal runs against `lit_p`.
+ *
+ * @return 0 if the tokens follow the distributions
+ */
+static int
+check_tokens(const unsigned char *data, size_t size, const double *lit_prob, double lit_p)
+{
+	unsigned long long freq[256] = { 0 };
+	size_t offs = 0;
+	size_t runs = 0;
+	size_t matches = 0;
+	size_t t;
+	int res = 0;
+
+	if (trace.failed) {
+		printf("  out of memory for tokens\n");
+		return 1;
+	}
+
+	for (t = 0; t < trace.num; ++t) {
+		const struct trace_entry *tok = &trace.tokens[t];
+		int before_match = t + 1 < trace.num && trace.tokens[t + 1].type == TOKEN_MATCH;
+
+		if (offs + tok->len > size) {
+			printf("  tokens cover more than %lu bytes\n", (unsigned long) size);
+			return 1;
+		}
+
+		if (tok->type == TOKEN_MATCH) {
+			/* Blocks are generated independently, so may start with a match */
+			if (t > 0 && trace.tokens[t - 1].type == TOKEN_MATCH && offs % BLOCK_SIZE != 0) {
+				printf("  match at %lu follows a match\n", (unsigned long) offs);
+				return 1;
+			}
+
+			matches += tok->len > 0;
+		}
+		else {
+			size_t i;
+
+			for (i = 0; i < tok->len; ++i) {
+				freq[data[offs + i]]++;
+			}
+
+			/* A single literal before a match only breaks up matches */
+			runs += !(tok->len == 1 && before_match);
+		}
+
+		offs += tok->len;
+	}
+
+	if (offs != size) {
+		printf("  tokens cover %lu of %lu bytes\n", (unsigned long) offs, (unsigned long) size);
+		return 1;
+	}
+
+	res |= check_chi_square("literals", freq, lit_prob, 256);
+
+	if (lit_p < 1.0) {
+		res |= check_proportion("literal runs", runs, runs + matches, lit_p);
+	}
+	else if (matches != 0) {
+		printf("  %lu matches, expected none\n", (unsigned long) matches);
+		res = 1;
+	}
+
+	return res;
+}
+
+/* Check length frequencies `len_freq` against `prob` */
+static int
+check_lengths(const unsigned int len_freq[NUM_LEN], const double *prob)
+{
+	unsigned long long freq[NUM_LEN];
+	size_t i;
+
+	for (i = 0; i < NUM_LEN; ++i) {
+		freq[i] = len_freq[i];
+	}
+
+	return check_chi_square("lengths", freq, prob, NUM_LEN);
+}
+
+static void
+print_config(const struct test_config *c)
+{
+	printf(" ratio %g, len_exp %g, lit_exp %g\n", c->ratio, c->len_exp, c->lit_exp);
+}
+
+/* Precise mode, lzdg_generate_data */
+static int
+test_precise(unsigned char *data)
+{
+	unsigned int len_freq[NUM_LEN];
+	double lit_prob[256];
+	double len_prob[NUM_LEN];
+	struct rng_state rng;
+	size_t i;
+	int res = 0;
+
+	for (i = 0; i < NUM_CONFIGS; ++i) {
+		const struct test_config *c = &configs[i];
+
+		print_config(c);
+
+		lzdg_seed(TEST_SEED + i);
+
+		trace_start();
+		lzdg_generate_data(data, TEST_SIZE, c->ratio, c->len_exp, c->lit_exp);
+		trace_stop();
+
+		power_probs(lit_prob, 256, c->lit_exp);
+
+		res |= check_tokens(data, TEST_SIZE, lit_prob, 1.0 / c->ratio);
+
+		/*
+		 * The last chunk of lengths of a block is only partly used, from
+		 * the longest length, so lengths are checked on whole chunks.
+		 */
+		rng_seed(&rng, TEST_SEED + i);
+
+		generate_lengths_from_distribution(&rng, len_freq, TEST_LENGTHS, c->len_exp);
+
+		power_probs(len_prob, NUM_LEN, c->len_exp);
+
+		res |= check_lengths(len_freq, len_prob);
+	}
+
+	return res;
+}
+
+/* Bulk mode, lzdg_generate_data_bulk */
+static int
+test_bulk(unsigned char *data)
+{
+	unsigned int len_freq[NUM_LEN];
+	double lit_prob[256];
+	double len_prob[NUM_LEN];
+	struct lzdg_bulk bulk;
+	struct rng_state rng;
+	size_t i;
+	int res = 0;
+
+	for (i = 0; i < NUM_CONFIGS; ++i) {
+		const struct test_config *c = &configs[i];
+		struct rng_bits bits = { 0, 0 };
+		double lit_p;
+
+		print_config(c);
+
+		setup_bulk(&bulk, c->ratio, c->len_exp, c->lit_exp);
+
+		/* Tables are fixed-point approximations of the distributions */
+		res |= check_samples("literal samples", bulk.tables.lit, SAMPLE_SIZE, 256, c->lit_exp);
+		res |= check_samples("length samples", bulk.tables.len, LEN_SAMPLE_SIZE, NUM_LEN, c->len_exp);
+
+		lit_p = (double) bulk.tables.lit_threshold / (1UL << TOKEN_BITS);
+
+		if (fabs(lit_p - 1.0 / c->ratio) > 1.0 / (1UL << TOKEN_BITS)) {
+			printf("  literal threshold %.5f, expected %.5f\n", lit_p, 1.0 / c->ratio);
+			res = 1;
+		}
+
+		lzdg_seed(TEST_SEED + i);
+
+		trace_start();
+		lzdg_generate_data_bulk(data, TEST_SIZE, c->ratio, c->len_exp, c->lit_exp);
+		trace_stop();
+
+		sample_probs(lit_prob, 256, bulk.tables.lit, SAMPLE_SIZE);
+
+		res |= check_tokens(data, TEST_SIZE, lit_prob, lit_p);
+
+		rng_seed(&rng, TEST_SEED + i);
+
+		generate_lengths_from_samples(&rng, &bits, len_freq, TEST_LENGTHS, bulk.tables.len);
+
+		sample_probs(len_prob, NUM_LEN, bulk.tables.len, LEN_SAMPLE_SIZE);
+
+		res |= check_lengths(len_freq, len_prob);
+	}
+
+	return res;
+}
+
+/*
+ * Settings where the data is only literals, or a single value, in both
+ * modes.
+ */
+static int
+test_degenerate(unsigned char *data)
+{
+	static const struct test_config literal_configs[] = {
+		{ 1.0, 3.0, 2.5 },
+		{ 0.5, 3.0, 1.0 }
+	};
+	double lit_prob[256];
+	struct lzdg_bulk bulk;
+	size_t i;
+	int res = 0;
+
+	for (i = 0; i < sizeof(literal_configs) / sizeof(literal_configs[0]); ++i) {
+		const struct test_config *c = &literal_configs[i];
+
+		print_config(c);
+
+		lzdg_seed(TEST_SEED + i);
+
+		printf("  precise\n");
+
+		trace_start();
+		lzdg_generate_data(data, TEST_SIZE, c->ratio, c->len_exp, c->lit_exp);
+		trace_stop();
+
+		power_probs(lit_prob, 256, c->lit_exp);
+
+		res |= check_tokens(data, TEST_SIZE, lit_prob, 1.0);
+
+		printf("  bulk\n");
+
+		setup_bulk(&bulk, c->ratio, c->len_exp, c->lit_exp);
+
+		if (!bulk.degenerate) {
+			printf("  not degenerate\n");
+			res = 1;
+		}
+
+		trace_start();
+		lzdg_generate_data_bulk(data, TEST_SIZE, c->ratio, c->len_exp, c->lit_exp);
+		trace_stop();
+
+		sample_probs(lit_prob, 256, bulk.tables.lit, SAMPLE_SIZE);
+
+		res |= check_tokens(data, TEST_SIZE, lit_prob, 1.0);
+	}
+
+	/* With a large literal exponent, all literal samples are zero */
+	printf(" ratio 3, len_exp 3, lit_exp 1e+06\n");
+
+	setup_bulk(&bulk, 3.0, 3.0, 1e6);
+
+	lzdg_generate_data_bulk(data, TEST_SIZE, 3.0, 3.0, 1e6);
+
+	if (!bulk.degenerate || data[0] != 0 || memcmp(data, data + 1, TEST_SIZE - 1) != 0) {
+		printf("  data is not all zero\n");
+		res = 1;
+	}
+	else {
+		printf("  data is all zero\n");
+	}
+
+	return res;
+}
+
+/* LZDG_FLAG_STREAM gives the same data as writing it directly */
+static int
+test_stream(unsigned char *data)
+{
+	static const struct test_config stream_configs[] = {
+		{ 3.0, 3.0, 2.5 },
+		{ 1.0, 3.0, 2.5 },
+		{ 3.0, 3.0, 1e6 }
+	};
+	static const size_t sizes[] = { BLOCK_SIZE, 3 * BLOCK_SIZE + 12345, 100 };
+	unsigned char *stream = data + TEST_SIZE / 2;
+	size_t i;
+	size_t j;
+	int res = 0;
+
+	for (i = 0; i < sizeof(stream_configs) / sizeof(stream_configs[0]); ++i) {
+		const struct test_config *c = &stream_configs[i];
+
+		print_config(c);
+
+		for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); ++j) {
+			lzdg_generate_block(data, sizes[j], c->ratio, c->len_exp, c->lit_exp,
+			                    TEST_SEED, j, LZDG_FLAG_BULK);
+			lzdg_generate_block(stream, sizes[j], c->ratio, c->len_exp, c->lit_exp,
+			                    TEST_SEED, j, LZDG_FLAG_BULK | LZDG_FLAG_STREAM);
+
+			if (memcmp(data, stream, sizes[j]) != 0) {
+				printf("  %lu bytes differ\n", (unsigned long) sizes[j]);
+				res = 1;
+			}
+			else {
+				printf("  %lu bytes equal\n", (unsigned long) sizes[j]);
+			}
+		}
+	}
+
+	return res;
+}
+
+/* Generate blocks of `size` bytes in order, in reverse, or in parallel */
+static void
+generate_blocks(unsigned char *data, size_t size, const struct test_config *c,
+                unsigned int flags, int order)
+{
+	int num_blocks = (int) ((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	int i;
+
+	if (order == 0) {
+		for (i = 0; i < num_blocks; ++i) {
+			size_t offs = (size_t) i * BLOCK_SIZE;
+			size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+
+			lzdg_generate_block(data + offs, num, c->ratio, c->len_exp, c->lit_exp,
+			                    TEST_SEED, i, flags);
+		}
+	}
+	else if (order == 1) {
+		for (i = num_blocks - 1; i >= 0; --i) {
+			size_t offs = (size_t) i * BLOCK_SIZE;
+			size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+
+			lzdg_generate_block(data + offs, num, c->ratio, c->len_exp, c->lit_exp,
+			                    TEST_SEED, i, flags);
+		}
+	}
+	else {
+#if defined(_OPENMP)
+#  pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for (i = 0; i < num_blocks; ++i) {
+			size_t offs = (size_t) i * BLOCK_SIZE;
+			size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+
+			lzdg_generate_block(data + offs, num, c->ratio, c->len_exp, c->lit_exp,
+			                    TEST_SEED, i, flags);
+		}
+	}
+}
+
+/*
+ * lzdg_generate_block, as used by lzdgen --jobs, gives the same data in any
+ * order, and the data of the blocks follows the distributions.
+ */
+static int
+test_block(unsigned char *data)
+{
+	static const char *const order_names[] = { "in reverse", "in parallel" };
+	size_t size = TEST_SIZE / 2 - 1000;
+	unsigned char *other = data + TEST_SIZE / 2;
+	double lit_prob[256];
+	unsigned int bulk;
+	int res = 0;
+
+	for (bulk = 0; bulk < 2; ++bulk) {
+		const struct test_config *c = &configs[0];
+		unsigned int flags = bulk ? LZDG_FLAG_BULK : 0;
+		int order;
+
+		printf(" %s", bulk ? "bulk," : "precise,");
+		print_config(c);
+
+		trace_start();
+		generate_blocks(data, size, c, flags, 0);
+		trace_stop();
+
+		if (bulk) {
+			struct lzdg_bulk b;
+
+			setup_bulk(&b, c->ratio, c->len_exp, c->lit_exp);
+			sample_probs(lit_prob, 256, b.tables.lit, SAMPLE_SIZE);
+
+			res |= check_tokens(data, size, lit_prob, (double) b.tables.lit_threshold / (1UL << TOKEN_BITS));
+		}
+		else {
+			power_probs(lit_prob, 256, c->lit_exp);
+
+			res |= check_tokens(data, size, lit_prob, 1.0 / c->ratio);
+		}
+
+		for (order = 1; order <= 2; ++order) {
+			memset(other, 0, size);
+
+			generate_blocks(other, size, c, flags, order);
+
+			if (memcmp(data, other, size) != 0) {
+				printf("  blocks generated %s differ\n", order_names[order - 1]);
+				res = 1;
+			}
+			else {
+				printf("  blocks generated %s equal\n", order_names[order - 1]);
+			}
+		}
+	}
+
+	return res;
+}
+
+/* Sorted segments of the int model are sorted, and within `bits` */
+static int
+test_int(unsigned char *data)
+{
+	static const char *const int_configs[][4] = {
+		{ "width=8", "bits=8", "delta=1", "dist=uniform" },
+		{ "width=16", "bits=10", "delta=10", "dist=normal" },
+		{ "width=32", "bits=32", "delta=1e6", "dist=log" },
+		{ "width=64", "bits=64", "delta=1e15", "run=4" },
+		{ "width=64", "bits=20", "delta=5000", "run=4" }
+	};
+	size_t i;
+	int res = 0;
+
+	for (i = 0; i < sizeof(int_configs) / sizeof(int_configs[0]); ++i) {
+		const char *options[5];
+		struct lzdg_model *model;
+		const char *error = NULL;
+		unsigned int width = (unsigned int) strtoul(int_configs[i][0] + 6, NULL, 10);
+		unsigned int bits = (unsigned int) strtoul(int_configs[i][1] + 5, NULL, 10);
+		uint64_t mask = UINT64_MAX >> (64 - bits);
+		size_t bytes = width / 8;
+		size_t unsorted = 0;
+		size_t segments = 0;
+		uint64_t index;
+
+		memcpy(options, int_configs[i], sizeof(int_configs[i]));
+		options[4] = "sorted=1";
+
+		printf(" %s, %s, %s, %s\n", options[0], options[1], options[2], options[3]);
+
+		model = lzdg_model_create("int", options, 5, TEST_SEED, &error);
+
+		if (model == NULL) {
+			printf("  %s\n", error);
+			res = 1;
+			continue;
+		}
+
+		for (index = 0; index < 4; ++index) {
+			size_t offs;
+
+			lzdg_model_generate(model, data, BLOCK_SIZE, index);
+
+			/* Segments of 1024 values start at the start of each block */
+			for (offs = 0; offs < BLOCK_SIZE; offs += 1024 * bytes, ++segments) {
+				uint64_t prev = 0;
+				size_t j;
+
+				for (j = 0; j < 1024 * bytes && offs + j < BLOCK_SIZE; j += bytes) {
+					uint64_t v = 0;
+					size_t b;
+
+					for (b = 0; b < bytes; ++b) {
+						v |= (uint64_t) data[offs + j + b] << (8 * b);
+					}
+
+					if (v < prev || v > mask) {
+						unsorted++;
+						break;
+					}
+
+					prev = v;
+				}
+			}
+		}
+
+		printf("  %lu of %lu segments not sorted within bits\n",
+		       (unsigned long) unsorted, (unsigned long) segments);
+
+		res |= unsorted != 0;
+
+		lzdg_model_destroy(model);
+	}
+
+	return res;
+}
+
+/* Configurations hashed for --digest and --compare */
+static const struct test_config digest_configs[] = {
+	{ 3.0, 3.0, 2.5 },
+	{ 2.0, 1.5, 3.0 },
+	{ 8.0, 2.0, 1.0 },
+	{ 1.0, 3.0, 2.5 },
+	{ 3.0, 3.0, 1e6 }
+};
+
+static const struct {
+	const char *name;
+	unsigned int flags;
+} digest_modes[] = {
+	{ "precise", 0 },
+	{ "bulk", LZDG_FLAG_BULK },
+	{ "stream", LZDG_FLAG_BULK | LZDG_FLAG_STREAM }
+};
+
+/* Bytes hashed for each configuration and mode, a partial block at the end */
+#define DIGEST_SIZE (3 * BLOCK_SIZE + 12345)
+
+#define NUM_DIGESTS (sizeof(digest_configs) / sizeof(digest_configs[0]) \
+                     * sizeof(digest_modes) / sizeof(digest_modes[0]))
+
+/* Return 64-bit FNV-1a hash of `size` bytes from `data` */
+static uint64_t
+fnv1a(const unsigned char *data, size_t size)
+{
+	uint64_t h = UINT64_C(0xCBF29CE484222325);
+	size_t i;
+
+	for (i = 0; i < size; ++i) {
+		h = (h ^ data[i]) * UINT64_C(0x100000001B3);
+	}
+
+	return h;
+}
+
+/* Generate data of digest `i` and format its hash as a line in `line` */
+static void
+digest_line(char *line, size_t line_size, unsigned char *data, size_t i)
+{
+	size_t num_modes = sizeof(digest_modes) / sizeof(digest_modes[0]);
+	const struct test_config *c = &digest_configs[i / num_modes];
+
+	generate_blocks(data, DIGEST_SIZE, c, digest_modes[i % num_modes].flags, 0);
+
+	snprintf(line, line_size, "%s %g %g %g %016llx\n", digest_modes[i % num_modes].name,
+	         c->ratio, c->len_exp, c->lit_exp,
+	         (unsigned long long) fnv1a(data, DIGEST_SIZE));
+}
+
+/* Write hashes of the data of the digest configurations to `file` */
+static int
+write_digests(const char *file, unsigned char *data)
+{
+	char line[128];
+	FILE *fp = fopen(file, "w");
+	size_t i;
+
+	if (fp == NULL) {
+		perror("lzdg-test: unable to open digest file");
+		return 1;
+	}
+
+	for (i = 0; i < NUM_DIGESTS; ++i) {
+		digest_line(line, sizeof(line), data, i);
+		fputs(line, fp);
+	}
+
+	if (fclose(fp) != 0) {
+		perror("lzdg-test: unable to write digest file");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * The data of the target_clones variant picked for the CPU is the same as
+ * that of the generic build which wrote `file`.
+ */
+static int
+compare_digests(const char *file, unsigned char *data)
+{
+	char line[128];
+	char expected[128];
+	FILE *fp = fopen(file, "r");
+	size_t i;
+	int res = 0;
+
+	if (fp == NULL) {
+		perror("lzdg-test: unable to open digest file");
+		return 1;
+	}
+
+	printf("clones:\n");
+
+	for (i = 0; i < NUM_DIGESTS; ++i) {
+		digest_line(line, sizeof(line), data, i);
+
+		if (fgets(expected, sizeof(expected), fp) == NULL) {
+			printf("  digest file ends early\n");
+			res = 1;
+			break;
+		}
+
+		if (strcmp(line, expected) != 0) {
+			printf("  differs: %s", line);
+			res = 1;
+		}
+		else {
+			printf("  equal: %s", line);
+		}
+	}
+
+	fclose(fp);
+
+	printf("clones: %s\n", res ? "FAILED" : "ok");
+
+	return res;
+}
+
+static const struct {
+	const char *name;
+	int (*func)(unsigned char *data);
+} tests[] = {
+	{ "precise", test_precise },
+	{ "bulk", test_bulk },
+	{ "degenerate", test_degenerate },
+	{ "stream", test_stream },
+	{ "block", test_block },
+	{ "int", test_int }
+};
+
+#define NUM_TESTS (sizeof(tests) / sizeof(tests[0]))
+
+int
+main(int argc, char *argv[])
+{
+	unsigned char *data = (unsigned char *) malloc(TEST_SIZE);
+	int failed = 0;
+	size_t i;
+	int j;
+
+	if (data == NULL) {
+		fprintf(stderr, "lzdg-test: out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc == 3 && (strcmp(argv[1], "--digest") == 0 || strcmp(argv[1], "--compare") == 0)) {
+		if (strcmp(argv[1], "--digest") == 0) {
+			failed = write_digests(argv[2], data);
+		}
+		else {
+			failed = compare_digests(argv[2], data);
+		}
+
+		free(trace.tokens);
+		free(data);
+
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	for (j = 1; j < argc; ++j) {
+		for (i = 0; i < NUM_TESTS; ++i) {
+			if (strcmp(argv[j], tests[i].name) == 0) {
+				break;
+			}
+		}
+
+		if (i == NUM_TESTS) {
+			fprintf(stderr, "lzdg-test: unknown test '%s'\n", argv[j]);
+			free(data);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < NUM_TESTS; ++i) {
+		int res;
+
+		if (argc > 1) {
+			for (j = 1; j < argc && strcmp(argv[j], tests[i].name) != 0; ++j) {
+				/* nothing */
+			}
+
+			if (j == argc) {
+				continue;
+			}
+		}
+
+		printf("%s:\n", tests[i].name);
+
+		res = tests[i].func(data);
+
+		printf("%s: %s\n", tests[i].name, res ? "FAILED" : "ok");
+
+		failed |= res;
+	}
+
+	free(trace.tokens);
+	free(data);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
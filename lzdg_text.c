@@ -0,0 +1,505 @@
+/*
+ * lzdatagen - LZ data generator
+ *
+ * Copyright 2016-2023 Joergen Ibsen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Text model.
+ *
+ * Text is built from a random vocabulary of words made of syllables, sampled
+ * by Zipf rank. As in natural languages, frequent words tend to be short.
+ * Words are copied from a packed arena with fixed size copies, and broken
+ * into sentences, paragraphs and lines.
+ */
+
+#include "lzdatagen.h"
+#include "lzdg_internal.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum length of vocabulary words */
+#define MAX_WORD_LEN 24
+
+/* Number of bytes copied for each word, and maximum written for each word */
+#define WORD_COPY 32
+
+/* Number of distinct syllables words are made of */
+#define NUM_SYLLABLES 1024
+
+struct text_params {
+	uint64_t vocab;
+	double zipf;
+	double word_len;
+	uint64_t sentence;
+	uint64_t paragraph;
+	uint64_t width;
+};
+
+static const struct lzdg_option text_options[] = {
+	{ "vocab", LZDG_OPT_UINT, offsetof(struct text_params, vocab), 1, 1000000, NULL,
+	  "text vocab must be 1 to 1000000" },
+	{ "zipf", LZDG_OPT_DOUBLE, offsetof(struct text_params, zipf), 0, 4, NULL,
+	  "text zipf must be 0.0 to 4.0" },
+	{ "word_len", LZDG_OPT_DOUBLE, offsetof(struct text_params, word_len), 1, 16, NULL,
+	  "text word_len must be 1.0 to 16.0" },
+	{ "sentence", LZDG_OPT_UINT, offsetof(struct text_params, sentence), 1, 1000, NULL,
+	  "text sentence must be 1 to 1000" },
+	{ "paragraph", LZDG_OPT_UINT, offsetof(struct text_params, paragraph), 0, 1000, NULL,
+	  "text paragraph must be 0 to 1000" },
+	{ "width", LZDG_OPT_UINT, offsetof(struct text_params, width), 0, 65535, NULL,
+	  "text width must be 0 to 65535" },
+	{ NULL, LZDG_OPT_UINT, 0, 0, 0, NULL, NULL }
+};
+
+/*
+ * Parts of syllables and their approximate weights in English words.
+ * Words are made of syllables, so they share substrings like real words.
+ */
+static const char *const onsets[] = {
+	"", "b", "c", "d", "f", "g", "h", "j", "k", "l", "m", "n", "p",
+	"r", "s", "t", "v", "w", "y", "z", "bl", "br", "ch", "cl", "cr",
+	"dr", "fl", "fr", "gr", "pl", "pr", "sh", "sl", "sp", "st", "str",
+	"th", "tr", "wh"
+};
+
+static const double onset_weights[] = {
+	12, 2, 3, 4, 2, 2, 4, 0.3, 1, 4, 3, 4, 2,
+	4, 5, 6, 1, 2, 1, 0.2, 0.5, 0.6, 1, 0.5, 0.5,
+	0.5, 0.4, 0.5, 0.5, 0.6, 0.6, 1, 0.4, 0.5, 1, 0.3,
+	3, 0.8, 0.6
+};
+
+static const char *const nuclei[] = {
+	"a", "e", "i", "o", "u", "ea", "ee", "ai", "ou", "io", "y", "oo", "ie"
+};
+
+static const double nucleus_weights[] = {
+	8, 10, 7, 7, 3, 1, 1, 0.6, 1, 0.5, 0.7, 0.5, 0.4
+};
+
+static const char *const codas[] = {
+	"", "n", "r", "s", "t", "l", "d", "m", "ng", "st", "nd", "ck", "ll",
+	"ss", "th", "x", "ch", "ct", "nt", "rs"
+};
+
+static const double coda_weights[] = {
+	14, 6, 5, 4, 4, 3, 2, 2, 1.5, 0.8, 1, 0.5, 0.5,
+	0.5, 0.6, 0.2, 0.3, 0.3, 1, 0.3
+};
+
+struct text_word {
+	uint32_t offs;
+	uint32_t len;
+};
+
+struct text_model {
+	struct text_params params;
+	struct lzdg_sampler ranks;
+	struct text_word *words;
+	unsigned char *arena;
+	uint64_t seed;
+};
+
+/* Position in the structure of the text while generating */
+struct text_cursor {
+	uint32_t sentence_left;
+	uint32_t paragraph_left;
+	size_t col;
+	int capital;
+};
+
+/* Syllable inventory, while building vocabulary */
+struct syllables {
+	char text[NUM_SYLLABLES][8];
+	unsigned char len[NUM_SYLLABLES];
+	struct lzdg_sampler ranks;
+};
+
+/* Vocabulary word and sort key, while building vocabulary */
+struct word_key {
+	double key;
+	struct text_word word;
+};
+
+static int
+compare_word_key(const void *a, const void *b)
+{
+	double ka = ((const struct word_key *) a)->key;
+	double kb = ((const struct word_key *) b)->key;
+
+	return (ka > kb) - (ka < kb);
+}
+
+/*
+ * Sample Poisson distributed value with mean `lambda`.
+ */
+static uint32_t
+poisson(struct rng_state *rng, double lambda)
+{
+	double limit = exp(-lambda);
+	double prod = rand_double(rng);
+	uint32_t k = 0;
+
+	while (prod > limit) {
+		prod *= rand_double(rng);
+		++k;
+	}
+
+	return k;
+}
+
+/*
+ * Sample count with triangular distribution in range [1;2 * mean - 1].
+ */
+static uint32_t
+sample_count(struct rng_state *rng, uint64_t mean)
+{
+	uint32_t a = (uint32_t) (((uint64_t) rng_next32(rng) * mean) >> 32);
+	uint32_t b = (uint32_t) (((uint64_t) rng_next32(rng) * mean) >> 32);
+
+	return 1 + a + b;
+}
+
+static uint32_t
+hash_word(const unsigned char *p, size_t len)
+{
+	uint32_t h = UINT32_C(0x811C9DC5);
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		h = (h ^ p[i]) * UINT32_C(0x01000193);
+	}
+
+	return h;
+}
+
+static int
+build_syllables(struct syllables *syl, struct rng_state *rng)
+{
+	struct lzdg_sampler parts[3];
+	const char *const *names[3] = { onsets, nuclei, codas };
+	int res = 1;
+	size_t i;
+	size_t j;
+
+	if (lzdg_sampler_init(&parts[0], onset_weights, ARRAY_SIZE(onset_weights))) {
+		return 1;
+	}
+
+	if (lzdg_sampler_init(&parts[1], nucleus_weights, ARRAY_SIZE(nucleus_weights))) {
+		goto out_onsets;
+	}
+
+	if (lzdg_sampler_init(&parts[2], coda_weights, ARRAY_SIZE(coda_weights))) {
+		goto out_nuclei;
+	}
+
+	for (i = 0; i < NUM_SYLLABLES; ++i) {
+		size_t len = 0;
+
+		for (j = 0; j < 3; ++j) {
+			const char *s = names[j][lzdg_sample(&parts[j], rng_next32(rng))];
+
+			while (*s != '\0') {
+				syl->text[i][len++] = *s++;
+			}
+		}
+
+		syl->len[i] = (unsigned char) len;
+	}
+
+	res = lzdg_sampler_init_zipf(&syl->ranks, NUM_SYLLABLES, 1.0);
+
+	lzdg_sampler_free(&parts[2]);
+out_nuclei:
+	lzdg_sampler_free(&parts[1]);
+out_onsets:
+	lzdg_sampler_free(&parts[0]);
+
+	return res;
+}
+
+static int
+build_vocabulary(struct text_model *m, struct rng_state *rng)
+{
+	struct syllables *syl;
+	struct word_key *keys;
+	uint32_t *hash_table;
+	size_t num_words = (size_t) m->params.vocab;
+	size_t min_len = m->params.word_len < 2.0 ? 1 : 2;
+	size_t hash_mask = 1;
+	size_t offs = 0;
+	size_t i;
+
+	while (hash_mask < 2 * num_words) {
+		hash_mask <<= 1;
+	}
+
+	hash_mask -= 1;
+
+	syl = (struct syllables *) malloc(sizeof(*syl));
+	keys = (struct word_key *) malloc(num_words * sizeof(keys[0]));
+	hash_table = (uint32_t *) calloc(hash_mask + 1, sizeof(hash_table[0]));
+	m->words = (struct text_word *) malloc(num_words * sizeof(m->words[0]));
+	m->arena = (unsigned char *) calloc(num_words * MAX_WORD_LEN + WORD_COPY, 1);
+
+	if (syl == NULL || keys == NULL || hash_table == NULL
+	 || m->words == NULL || m->arena == NULL || build_syllables(syl, rng)) {
+		free(hash_table);
+		free(keys);
+		free(syl);
+		return 1;
+	}
+
+	/*
+	 * Words are strings of syllables, with Poisson distributed lengths of at
+	 * least two letters, since most one letter words would be consonants.
+	 * Duplicates are retried, with longer lengths after a few tries, so
+	 * there are only a few distinct short words, like in real languages.
+	 */
+	for (i = 0; i < num_words; ++i) {
+		unsigned char *word = m->arena + offs;
+		unsigned int tries;
+
+		for (tries = 0; ; ++tries) {
+			size_t len = min_len + poisson(rng, m->params.word_len - min_len) + tries / 8;
+			size_t pos;
+			size_t k;
+
+			if (len > MAX_WORD_LEN) {
+				len = MAX_WORD_LEN;
+			}
+
+			for (pos = 0; pos < len; ) {
+				size_t s = lzdg_sample(&syl->ranks, rng_next32(rng));
+
+				for (k = 0; k < syl->len[s] && pos < len; ++k) {
+					word[pos++] = (unsigned char) syl->text[s][k];
+				}
+			}
+
+			/* Look up word, and insert it if not found */
+			for (k = hash_word(word, len) & hash_mask; hash_table[k] != 0; k = (k + 1) & hash_mask) {
+				const struct text_word *w = &keys[hash_table[k] - 1].word;
+
+				if (w->len == len && memcmp(m->arena + w->offs, word, len) == 0) {
+					break;
+				}
+			}
+
+			if (hash_table[k] == 0) {
+				hash_table[k] = (uint32_t) (i + 1);
+				keys[i].word.offs = (uint32_t) offs;
+				keys[i].word.len = (uint32_t) len;
+				offs += len;
+				break;
+			}
+		}
+
+		/* Sort by length with some noise, so short words are more frequent */
+		keys[i].key = keys[i].word.len + 4.0 * rand_double(rng);
+	}
+
+	qsort(keys, num_words, sizeof(keys[0]), compare_word_key);
+
+	for (i = 0; i < num_words; ++i) {
+		m->words[i] = keys[i].word;
+	}
+
+	/* Clear the rest of the arena, so every word can be copied with WORD_COPY bytes */
+	memset(m->arena + offs, 0, WORD_COPY);
+
+	lzdg_sampler_free(&syl->ranks);
+	free(hash_table);
+	free(keys);
+	free(syl);
+
+	return 0;
+}
+
+static void
+text_destroy(void *state)
+{
+	struct text_model *m = (struct text_model *) state;
+
+	if (m == NULL) {
+		return;
+	}
+
+	lzdg_sampler_free(&m->ranks);
+	free(m->arena);
+	free(m->words);
+	free(m);
+}
+
+static void *
+text_create(const char *const *options, size_t num_options, uint64_t seed, const char **error)
+{
+	struct text_params params = { 10000, 1.0, 7.0, 15, 5, 72 };
+	struct text_model *m;
+	struct rng_state rng;
+
+	if (lzdg_parse_options(text_options, &params, options, num_options, error)) {
+		return NULL;
+	}
+
+	m = (struct text_model *) calloc(1, sizeof(*m));
+
+	if (m == NULL) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	m->params = params;
+	m->seed = seed;
+
+	rng_seed(&rng, seed ^ UINT64_C(0x9E3779B97F4A7C15));
+
+	if (build_vocabulary(m, &rng)
+	 || lzdg_sampler_init_zipf(&m->ranks, (size_t) params.vocab, params.zipf)) {
+		text_destroy(m);
+		*error = "out of memory";
+		return NULL;
+	}
+
+	return m;
+}
+
+/*
+ * Emit words at `p` while `p` is below `limit`, writing at most WORD_COPY
+ * bytes past `limit`.
+ */
+static unsigned char *
+text_emit(const struct text_model *m, struct rng_state *rng, struct rng_bits *bits,
+          struct text_cursor *c, unsigned char *p, const unsigned char *limit)
+{
+	const size_t width = (size_t) m->params.width;
+
+	while (p < limit) {
+		const struct text_word *w = &m->words[lzdg_sample(&m->ranks, rng_next32(rng))];
+
+		/* Break line at the space before the word if it does not fit */
+		if (width != 0 && c->col != 0 && c->col + w->len >= width) {
+			p[-1] = '\n';
+			c->col = 0;
+		}
+
+		memcpy(p, m->arena + w->offs, WORD_COPY);
+
+		if (c->capital) {
+			*p = (unsigned char) (*p - 'a' + 'A');
+			c->capital = 0;
+		}
+
+		p += w->len;
+		c->col += w->len;
+
+		if (--c->sentence_left != 0) {
+			/* Add comma with probability 1/8, without branching */
+			size_t comma = rng_take_bits(rng, bits, 3) == 0;
+
+			p[0] = comma ? ',' : ' ';
+			p[1] = ' ';
+			p += 1 + comma;
+			c->col += 1 + comma;
+
+			continue;
+		}
+
+		/* End sentence, mostly with a period */
+		switch (rng_take_bits(rng, bits, 5)) {
+		case 0:
+			*p++ = '!';
+			break;
+		case 1:
+		case 2:
+			*p++ = '?';
+			break;
+		default:
+			*p++ = '.';
+			break;
+		}
+
+		c->capital = 1;
+		c->sentence_left = sample_count(rng, m->params.sentence);
+
+		if (m->params.paragraph != 0 && --c->paragraph_left == 0) {
+			*p++ = '\n';
+			*p++ = '\n';
+			c->col = 0;
+			c->paragraph_left = sample_count(rng, m->params.paragraph);
+		}
+		else {
+			*p++ = ' ';
+			c->col += 2;
+		}
+	}
+
+	return p;
+}
+
+static void
+text_generate(const void *state, unsigned char *ptr, size_t size, uint64_t index)
+{
+	const struct text_model *m = (const struct text_model *) state;
+	unsigned char tmp[1 + 2 * WORD_COPY];
+	unsigned char *p = ptr;
+	unsigned char *end = ptr + size;
+	struct rng_state rng;
+	struct rng_bits bits = { 0, 0 };
+	struct text_cursor c;
+	size_t keep;
+	size_t left;
+
+	rng_seed_block(&rng, m->seed, index);
+
+	/* Each block starts a new paragraph */
+	c.sentence_left = sample_count(&rng, m->params.sentence);
+	c.paragraph_left = m->params.paragraph ? sample_count(&rng, m->params.paragraph) : 0;
+	c.col = 0;
+	c.capital = 1;
+
+	if (size > WORD_COPY) {
+		p = text_emit(m, &rng, &bits, &c, p, end - WORD_COPY);
+	}
+
+	/*
+	 * Emit the rest into tmp, after a copy of the last byte written, which
+	 * may be changed to a line break.
+	 */
+	keep = p > ptr ? 1 : 0;
+	left = (size_t) (end - p);
+
+	tmp[0] = keep ? p[-1] : ' ';
+
+	text_emit(m, &rng, &bits, &c, tmp + 1, tmp + 1 + left);
+
+	memcpy(p - keep, tmp + 1 - keep, left + keep);
+}
+
+const struct lzdg_model_type lzdg_text_model = {
+	"text",
+	"words from a Zipfian vocabulary, in sentences and lines",
+	text_create,
+	text_generate,
+	text_destroy
+};
@@ -20,6 +20,10 @@
 
 #define _POSIX_C_SOURCE 200809L
 
+#if defined(__linux__)
+#  define _GNU_SOURCE
+#endif
+
 #if defined(_MSC_VER)
 #  define _CRT_NONSTDC_NO_DEPRECATE
 #  define _CRT_SECURE_NO_WARNINGS
@@ -28,7 +32,13 @@
 #if defined(_WIN32) || defined(__CYGWIN__)
 #  include <io.h>
 #else
+#  include <poll.h>
+#  include <signal.h>
+#  include <sys/resource.h>
+#  include <sys/uio.h>
+#  include <sys/wait.h>
 #  include <unistd.h>
+#  define LZDG_HAVE_EXEC
 #endif
 
 #include <sys/stat.h>
@@ -38,6 +48,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -46,75 +57,697 @@
 #include <time.h>
 
 #include "lzdatagen.h"
+#include "lzdg_cli.h"
 #include "parg.h"
-#include "pcg_basic.h"
 
 #define EXE_NAME "lzdgen"
 
 #define BLOCK_SIZE (1024 * 1024)
 
-/* Wrapper around strtoull to parse size suffixes */
-static unsigned long long
-strtosize(const char *s, char **endptr, int base)
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Maximum number of model parameters on the command line */
+#define MAX_PARAMS 64
+
+/*
+ * Scale of Kolmogorov-Smirnov distance accepted by check. Matches repeat
+ * literals, so the distance shrinks slower than for independent samples,
+ * the limit is CHECK_DISTANCE_SCALE / sqrt(size).
+ */
+#define CHECK_DISTANCE_SCALE 64.0
+
+/* Ratio values tried when calibrating */
+static const double calibration_ratios[] = {
+	1.0, 1.25, 1.5, 2.0, 2.5, 3.0, 4.0, 5.0, 6.0, 8.0, 10.0, 12.0, 16.0
+};
+
+/* Maximum number of exponents swept when calibrating */
+#define MAX_CALIBRATION_EXPS 16
+
+#if defined(LZDG_HAVE_EXEC)
+/**
+ * State for piping generated data through a command.
+ */
+struct exec_state {
+	pid_t pid;                     /**< Process id of `/bin/sh -c COMMAND` */
+	int in_fd;                     /**< Write end of command stdin */
+	int out_fd;                    /**< Read end of command stdout, or -1 */
+	int use_vmsplice;              /**< Non-zero if vmsplice may be used */
+	unsigned long long out_size;   /**< Bytes read from command stdout */
+	unsigned char drain[64 * 1024];
+};
+
+/* Return monotonic time in seconds */
+static double
+get_time(void)
 {
-	char *ep = NULL;
-	unsigned long long v;
-	int power = 0;
-	int orig_errno = errno;
-
-	errno = 0;
-
-	v = strtoull(s, &ep, base);
-
-	if (errno == 0) {
-		errno = orig_errno;
-	}
-
-	if (ep == s) {
-		goto done;
-	}
-
-	switch (*ep) {
-	case 'k':
-	case 'K':
-		power = 1;
-		++ep;
-		break;
-	case 'm':
-	case 'M':
-		power = 2;
-		++ep;
-		break;
-	case 'g':
-	case 'G':
-		power = 3;
-		++ep;
-		break;
-	case 't':
-	case 'T':
-		power = 4;
-		++ep;
-		break;
-	default:
-		break;
-	}
-
-	while (power--) {
-		if (v > ULLONG_MAX / 1024ULL) {
-			errno = ERANGE;
-			v = ULLONG_MAX;
-			break;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Read whatever is available on the command stdout, returns -1 on error */
+static int
+exec_drain(struct exec_state *ex)
+{
+	for (;;) {
+		ssize_t res = read(ex->out_fd, ex->drain, sizeof(ex->drain));
+
+		if (res > 0) {
+			ex->out_size += (unsigned long long) res;
+			continue;
+		}
+
+		if (res == 0) {
+			close(ex->out_fd);
+			ex->out_fd = -1;
+			return 0;
+		}
+
+		if (errno == EINTR) {
+			continue;
+		}
+
+		return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+	}
+}
+
+/**
+ * Start `/bin/sh -c cmd` with pipes connected to stdin and stdout.
+ *
+ * On Linux the stdin pipe is resized to at most `BLOCK_SIZE` bytes, so data
+ * can be passed with vmsplice as long as the caller alternates between two
+ * buffers of `BLOCK_SIZE` bytes (see `exec_write`).
+ */
+static int
+exec_start(struct exec_state *ex, const char *cmd)
+{
+	int in_pipe[2];
+	int out_pipe[2];
+
+	if (pipe(in_pipe) != 0) {
+		return -1;
+	}
+
+	if (pipe(out_pipe) != 0) {
+		close(in_pipe[0]);
+		close(in_pipe[1]);
+		return -1;
+	}
+
+	ex->pid = fork();
+
+	if (ex->pid < 0) {
+		close(in_pipe[0]);
+		close(in_pipe[1]);
+		close(out_pipe[0]);
+		close(out_pipe[1]);
+		return -1;
+	}
+
+	if (ex->pid == 0) {
+		dup2(in_pipe[0], STDIN_FILENO);
+		dup2(out_pipe[1], STDOUT_FILENO);
+		close(in_pipe[0]);
+		close(in_pipe[1]);
+		close(out_pipe[0]);
+		close(out_pipe[1]);
+		execl("/bin/sh", "sh", "-c", cmd, (char *) NULL);
+		_exit(127);
+	}
+
+	close(in_pipe[0]);
+	close(out_pipe[1]);
+
+	ex->in_fd = in_pipe[1];
+	ex->out_fd = out_pipe[0];
+	ex->out_size = 0;
+	ex->use_vmsplice = 0;
+
+	fcntl(ex->in_fd, F_SETFL, fcntl(ex->in_fd, F_GETFL) | O_NONBLOCK);
+	fcntl(ex->out_fd, F_SETFL, fcntl(ex->out_fd, F_GETFL) | O_NONBLOCK);
+
+#if defined(__linux__) && defined(F_SETPIPE_SZ)
+	fcntl(ex->in_fd, F_SETPIPE_SZ, BLOCK_SIZE);
+
+	{
+		int pipe_size = fcntl(ex->in_fd, F_GETPIPE_SZ);
+
+		ex->use_vmsplice = pipe_size > 0 && pipe_size <= BLOCK_SIZE;
+	}
+#endif
+
+	/* A command exiting early should be reported, not kill us */
+	signal(SIGPIPE, SIG_IGN);
+
+	return 0;
+}
+
+/**
+ * Write `size` bytes from `ptr` to the command, draining its output.
+ *
+ * With vmsplice the pipe references the pages of `ptr` instead of copying
+ * them. Since the pipe holds at most `BLOCK_SIZE` bytes, once the next
+ * buffer of `BLOCK_SIZE` bytes has been written, the command has consumed
+ * all of this one, and it may be reused.
+ */
+static int
+exec_write(struct exec_state *ex, const unsigned char *ptr, size_t size)
+{
+	while (size > 0) {
+		struct pollfd pfd[2];
+		ssize_t res;
+
+		pfd[0].fd = ex->in_fd;
+		pfd[0].events = POLLOUT;
+		pfd[1].fd = ex->out_fd;
+		pfd[1].events = POLLIN;
+
+		if (poll(pfd, ex->out_fd < 0 ? 1 : 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		if (ex->out_fd >= 0 && (pfd[1].revents & (POLLIN | POLLHUP))) {
+			if (exec_drain(ex) != 0) {
+				return -1;
+			}
+		}
+
+		if (!(pfd[0].revents & (POLLOUT | POLLERR | POLLHUP))) {
+			continue;
+		}
+
+#if defined(__linux__)
+		if (ex->use_vmsplice) {
+			struct iovec iov;
+
+			iov.iov_base = (void *) ptr;
+			iov.iov_len = size;
+
+			res = vmsplice(ex->in_fd, &iov, 1, SPLICE_F_NONBLOCK);
+
+			if (res < 0 && errno != EAGAIN && errno != EINTR && errno != EPIPE) {
+				/* Fall back to write if vmsplice is not supported */
+				ex->use_vmsplice = 0;
+				continue;
+			}
+		}
+		else
+#endif
+		{
+			res = write(ex->in_fd, ptr, size);
+		}
+
+		if (res < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		ptr += res;
+		size -= (size_t) res;
+	}
+
+	return 0;
+}
+
+/**
+ * Close command stdin, read remaining output and wait for it to exit.
+ *
+ * @return exit status of command, or -1 on error
+ */
+static int
+exec_finish(struct exec_state *ex)
+{
+	int status = 0;
+
+	if (ex->in_fd >= 0) {
+		close(ex->in_fd);
+		ex->in_fd = -1;
+	}
+
+	while (ex->out_fd >= 0) {
+		struct pollfd pfd;
+
+		pfd.fd = ex->out_fd;
+		pfd.events = POLLIN;
+
+		if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+			return -1;
+		}
+
+		if (exec_drain(ex) != 0) {
+			return -1;
+		}
+	}
+
+	while (waitpid(ex->pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			return -1;
+		}
+	}
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Print throughput and CPU time of lzdgen and the command */
+static void
+exec_report(const struct exec_state *ex, unsigned long long size, double seconds)
+{
+	struct rusage ru_self;
+	struct rusage ru_child;
+
+	getrusage(RUSAGE_SELF, &ru_self);
+	getrusage(RUSAGE_CHILDREN, &ru_child);
+
+	if (seconds <= 0.0) {
+		seconds = 1e-9;
+	}
+
+	fprintf(stderr,
+	        EXE_NAME ": in %llu bytes, %.1f MB/s; out %llu bytes; ratio %.3f\n"
+	        EXE_NAME ": wall %.3f s; cpu " EXE_NAME " %.3f s user %.3f s sys,"
+	        " command %.3f s user %.3f s sys\n",
+	        size, size / seconds / 1e6, ex->out_size,
+	        (double) size / (ex->out_size ? ex->out_size : 1),
+	        seconds,
+	        ru_self.ru_utime.tv_sec + ru_self.ru_utime.tv_usec / 1e6,
+	        ru_self.ru_stime.tv_sec + ru_self.ru_stime.tv_usec / 1e6,
+	        ru_child.ru_utime.tv_sec + ru_child.ru_utime.tv_usec / 1e6,
+	        ru_child.ru_stime.tv_sec + ru_child.ru_stime.tv_usec / 1e6);
+}
+
+/**
+ * Generate `size` bytes and pipe them through `cmd`.
+ *
+ * If `model` is not `NULL`, the data is generated by `model` instead.
+ *
+ * @param buffer pointer to two buffers of `BLOCK_SIZE` bytes
+ * @return 0 on success
+ */
+static int
+exec_generate(struct exec_state *ex, const char *cmd, unsigned char *buffer,
+              size_t size, double ratio, double len_exp, double lit_exp,
+              int flag_bulk, const struct lzdg_model *model)
+{
+	size_t offs = 0;
+	size_t block = 0;
+	int status;
+
+	if (exec_start(ex, cmd) != 0) {
+		perror(EXE_NAME ": unable to start command");
+		return -1;
+	}
+
+	while (offs < size) {
+		size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+		unsigned char *p = buffer + (block++ & 1) * BLOCK_SIZE;
+
+		if (model != NULL) {
+			lzdg_model_generate(model, p, num, offs / BLOCK_SIZE);
+		}
+		else if (flag_bulk) {
+			lzdg_generate_data_bulk(p, num, ratio, len_exp, lit_exp);
+		}
+		else {
+			lzdg_generate_data(p, num, ratio, len_exp, lit_exp);
+		}
+
+		if (exec_write(ex, p, num) != 0) {
+			perror(EXE_NAME ": write error");
+			exec_finish(ex);
+			return -1;
+		}
+
+		offs += num;
+	}
+
+	status = exec_finish(ex);
+
+	if (status != 0) {
+		fprintf(stderr, EXE_NAME ": command failed with status %d\n", status);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Write calibration table for `cmd` to `fp`.
+ *
+ * For each combination of the `num_lit_exps` values in `lit_exps`, the
+ * `num_len_exps` values in `len_exps` and the values in `calibration_ratios`,
+ * generate `size` bytes from `seed`, pipe them through `cmd` and record the
+ * ratio it achieves.
+ *
+ * @return 0 on success
+ */
+static int
+calibrate(struct exec_state *ex, const char *cmd, FILE *fp, unsigned char *buffer,
+          uint64_t seed, size_t size, const double *len_exps, int num_len_exps,
+          const double *lit_exps, int num_lit_exps, int flag_bulk)
+{
+	int i, j;
+	size_t k;
+
+	fprintf(fp, "# " EXE_NAME " calibration for `%s', size %llu\n",
+	        cmd, (unsigned long long) size);
+	fprintf(fp, "# mode lit_exp len_exp ratio achieved\n");
+
+	for (i = 0; i < num_lit_exps; ++i) {
+		for (j = 0; j < num_len_exps; ++j) {
+			for (k = 0; k < ARRAY_SIZE(calibration_ratios); ++k) {
+				double achieved;
+
+				lzdg_seed(seed);
+
+				if (exec_generate(ex, cmd, buffer, size, calibration_ratios[k],
+				                  len_exps[j], lit_exps[i], flag_bulk, NULL) != 0) {
+					return -1;
+				}
+
+				achieved = (double) size / (ex->out_size ? ex->out_size : 1);
+
+				fprintf(fp, "%s %f %f %f %f\n", flag_bulk ? "bulk" : "precise",
+				        lit_exps[i], len_exps[j], calibration_ratios[k], achieved);
+				fflush(fp);
+			}
+		}
+	}
+
+	return ferror(fp) ? -1 : 0;
+}
+#endif /* LZDG_HAVE_EXEC */
+
+/**
+ * Calibration table entry.
+ */
+struct calibration_row {
+	double lit_exp;
+	double len_exp;
+	double ratio;
+	double achieved;
+};
+
+/* Order rows by exponents, then by achieved ratio */
+static int
+compare_calibration_rows(const void *a, const void *b)
+{
+	const struct calibration_row *ra = (const struct calibration_row *) a;
+	const struct calibration_row *rb = (const struct calibration_row *) b;
+
+	if (ra->lit_exp != rb->lit_exp) {
+		return ra->lit_exp < rb->lit_exp ? -1 : 1;
+	}
+
+	if (ra->len_exp != rb->len_exp) {
+		return ra->len_exp < rb->len_exp ? -1 : 1;
+	}
+
+	if (ra->achieved != rb->achieved) {
+		return ra->achieved < rb->achieved ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Find grid values `lo` and `hi` bracketing `x` among the values selected by
+ * `get` in `num` sorted `rows`.
+ *
+ * @return 0 on success, 1 if `x` is outside the grid
+ */
+static int
+bracket_exp(const struct calibration_row *rows, size_t num, double x,
+            double (*get)(const struct calibration_row *),
+            double *lo, double *hi)
+{
+	int have_lo = 0;
+	int have_hi = 0;
+	size_t i;
+
+	for (i = 0; i < num; ++i) {
+		double v = get(&rows[i]);
+
+		if (v <= x + 1e-6 && (!have_lo || v > *lo)) {
+			*lo = v;
+			have_lo = 1;
+		}
+
+		if (v >= x - 1e-6 && (!have_hi || v < *hi)) {
+			*hi = v;
+			have_hi = 1;
+		}
+	}
+
+	return have_lo && have_hi ? 0 : 1;
+}
+
+static double
+row_lit_exp(const struct calibration_row *row)
+{
+	return row->lit_exp;
+}
+
+static double
+row_len_exp(const struct calibration_row *row)
+{
+	return row->len_exp;
+}
+
+/**
+ * Look up ratio needed to achieve `target` for grid point `lit_exp`,
+ * `len_exp` in `num` sorted `rows`.
+ *
+ * Rows are sorted by achieved ratio, so a table where the achieved ratio is
+ * not monotone in the ratio still gives a single answer.
+ *
+ * @return 0 on success, 1 if `target` is not bracketed
+ */
+static int
+grid_ratio(const struct calibration_row *rows, size_t num, double target,
+           double lit_exp, double len_exp, double *ratio)
+{
+	const struct calibration_row *prev = NULL;
+	size_t i;
+
+	for (i = 0; i < num; ++i) {
+		const struct calibration_row *row = &rows[i];
+
+		if (row->lit_exp != lit_exp || row->len_exp != len_exp) {
+			continue;
+		}
+
+		if (row->achieved == target) {
+			*ratio = row->ratio;
+			return 0;
+		}
+
+		if (prev != NULL && prev->achieved < target && row->achieved > target) {
+			*ratio = prev->ratio + (row->ratio - prev->ratio)
+			       * (target - prev->achieved) / (row->achieved - prev->achieved);
+			return 0;
 		}
 
-		v *= 1024ULL;
+		prev = row;
 	}
 
-done:
-	if (endptr != NULL) {
-		*endptr = ep;
+	return 1;
+}
+
+/**
+ * Look up ratio parameter needed to achieve `target` in calibration `file`.
+ *
+ * Only entries for the generation mode given by `flag_bulk` are used. For
+ * each of the grid exponents bracketing `len_exp` and `lit_exp`, the ratio is
+ * linearly interpolated between the entries whose achieved ratios bracket
+ * `target`, and the results are bilinearly interpolated in the exponents.
+ *
+ * @return 0 on success, -1 if `file` could not be read, 1 if no entry found
+ */
+static int
+calibrated_ratio(const char *file, double target, double len_exp, double lit_exp,
+                 int flag_bulk, double *ratio)
+{
+	char line[256];
+	struct calibration_row *rows = NULL;
+	size_t num_rows = 0;
+	size_t max_rows = 0;
+	double l0, l1, m0, m1;
+	double r00, r01, r10, r11;
+	double tl, tm;
+	FILE *fp;
+	int res = 1;
+
+	fp = fopen(file, "r");
+
+	if (fp == NULL) {
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		struct calibration_row row;
+		char mode[16];
+
+		if (line[0] == '#' || sscanf(line, "%15s %lf %lf %lf %lf", mode, &row.lit_exp,
+		                             &row.len_exp, &row.ratio, &row.achieved) != 5) {
+			continue;
+		}
+
+		if (strcmp(mode, flag_bulk ? "bulk" : "precise") != 0) {
+			continue;
+		}
+
+		if (num_rows == max_rows) {
+			size_t new_max = max_rows ? 2 * max_rows : 64;
+			struct calibration_row *new_rows = realloc(rows, new_max * sizeof(*rows));
+
+			if (new_rows == NULL) {
+				res = -1;
+				goto out;
+			}
+
+			rows = new_rows;
+			max_rows = new_max;
+		}
+
+		rows[num_rows++] = row;
 	}
 
-	return v;
+	if (ferror(fp)) {
+		res = -1;
+		goto out;
+	}
+
+	qsort(rows, num_rows, sizeof(*rows), compare_calibration_rows);
+
+	if (bracket_exp(rows, num_rows, lit_exp, row_lit_exp, &l0, &l1) != 0
+	 || bracket_exp(rows, num_rows, len_exp, row_len_exp, &m0, &m1) != 0) {
+		goto out;
+	}
+
+	if (grid_ratio(rows, num_rows, target, l0, m0, &r00) != 0
+	 || grid_ratio(rows, num_rows, target, l0, m1, &r01) != 0
+	 || grid_ratio(rows, num_rows, target, l1, m0, &r10) != 0
+	 || grid_ratio(rows, num_rows, target, l1, m1, &r11) != 0) {
+		goto out;
+	}
+
+	tl = l1 > l0 ? (lit_exp - l0) / (l1 - l0) : 0.0;
+	tm = m1 > m0 ? (len_exp - m0) / (m1 - m0) : 0.0;
+
+	*ratio = (1.0 - tl) * ((1.0 - tm) * r00 + tm * r01)
+	       + tl * ((1.0 - tm) * r10 + tm * r11);
+	res = 0;
+
+out:
+	free(rows);
+	fclose(fp);
+
+	return res;
+}
+
+/**
+ * Generate `size` bytes as independent blocks of `BLOCK_SIZE` bytes.
+ *
+ * Block `i` of `buffer` is block `first + i` of the stream given by `seed`,
+ * or by `model` if not `NULL`, so the data does not depend on the number of
+ * threads used.
+ */
+static void
+generate_blocks(unsigned char *buffer, size_t size, double ratio, double len_exp,
+                double lit_exp, uint64_t seed, uint64_t first, unsigned int flags,
+                const struct lzdg_model *model, int jobs)
+{
+	int num_blocks = (int) ((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	int i;
+
+#if defined(_OPENMP)
+#  pragma omp parallel for num_threads(jobs) schedule(static, 1)
+#endif
+	for (i = 0; i < num_blocks; ++i) {
+		size_t offs = (size_t) i * BLOCK_SIZE;
+		size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+
+		if (model != NULL) {
+			lzdg_model_generate(model, buffer + offs, num, first + i);
+		}
+		else {
+			lzdg_generate_block(buffer + offs, num, ratio, len_exp, lit_exp,
+			                    seed, first + i, flags);
+		}
+	}
+
+	(void) jobs;
+}
+
+/**
+ * Compare byte frequencies `freq` to the literal distribution.
+ *
+ * Matches are copies of literals, so every output byte should follow the
+ * literal distribution, where the probability of a value less than `k` is
+ * `(k / 256)^(1 / lit_exp)`.
+ *
+ * Prints the Kolmogorov-Smirnov distance and the chi-square statistic per
+ * degree of freedom. Since matches repeat literals, the chi-square statistic
+ * is larger than for independent samples, so only the distance is checked.
+ *
+ * @return 0 if distance is within limit
+ */
+static int
+check_distribution(const unsigned long long freq[256], double lit_exp)
+{
+	unsigned long long total = 0;
+	unsigned long long count = 0;
+	double max_dist = 0.0;
+	double limit;
+	double chi2 = 0.0;
+	int df = -1;
+	int k;
+
+	for (k = 0; k < 256; ++k) {
+		total += freq[k];
+	}
+
+	for (k = 0; k < 256; ++k) {
+		double cdf_lo = pow(k / 256.0, 1.0 / lit_exp);
+		double cdf_hi = pow((k + 1) / 256.0, 1.0 / lit_exp);
+		double expected = (cdf_hi - cdf_lo) * total;
+		double dist;
+
+		count += freq[k];
+
+		dist = fabs((double) count / total - cdf_hi);
+
+		if (dist > max_dist) {
+			max_dist = dist;
+		}
+
+		if (expected > 0.0) {
+			chi2 += (freq[k] - expected) * (freq[k] - expected) / expected;
+			df++;
+		}
+	}
+
+	limit = CHECK_DISTANCE_SCALE / sqrt((double) total);
+
+	fprintf(stderr, EXE_NAME ": check: %llu bytes, KS distance %.5f (limit %.5f),"
+	        " chi-square/df %.2f\n",
+	        total, max_dist, limit, df > 0 ? chi2 / df : 0.0);
+
+	if (max_dist > limit) {
+		fprintf(stderr, EXE_NAME ": check: literal distribution differs from"
+		        " exponent %.3f\n", lit_exp);
+		return -1;
+	}
+
+	return 0;
 }
 
 static void
@@ -132,12 +765,15 @@ printf_error(const char *fmt, ...)
 	    stderr,
 	    "\n"
 	    "usage: " EXE_NAME " [-bfhVv] [-l EXP] [-m EXP] [-r RATIO] [-S SEED]\n"
-	    "              [-s SIZE] OUTFILE\n");
+	    "              [-s SIZE] [-x COMMAND] [-C FILE -R RATIO] [-ck] [-j N]\n"
+	    "              [-t TYPE] [-p KEY=VALUE]... OUTFILE\n");
 }
 
 static void
 print_help(void)
 {
+	size_t i;
+
 	printf(
 	    "usage: " EXE_NAME " [options] OUTFILE\n"
 	    "\n"
@@ -145,18 +781,43 @@ print_help(void)
 	    "\n"
 	    "options:\n"
 	    "  -b, --bulk             use faster, less precise method\n"
+	    "  -C, --calibration FILE read calibration table from FILE\n"
+	    "  -c, --calibrate        write calibration table for COMMAND to OUTFILE\n"
 	    "  -f, --force            overwrite output file\n"
 	    "  -h, --help             print this help and exit\n"
+	    "  -j, --jobs N           generate independent blocks using N threads\n"
+	    "  -k, --check            check distribution of generated bytes\n"
 	    "  -l, --literal-exp EXP  literal distribution exponent [3.0]\n"
 	    "  -m, --match-exp EXP    match length distribution exponent [3.0]\n"
 	    "  -o, --output OUTFILE   write output to OUTFILE\n"
+	    "  -p, --param KEY=VALUE  set parameter of model TYPE, may be repeated\n"
+	    "  -R, --target-ratio RATIO\n"
+	    "                         achieved ratio target using calibration\n"
 	    "  -r, --ratio RATIO      compression ratio target [3.0]\n"
 	    "  -S, --seed SEED        use 64-bit SEED to seed PRNG\n"
 	    "  -s, --size SIZE        size with opt. k/m/g suffix [1m]\n"
+	    "  -t, --type TYPE        type of data to generate [lz]\n"
 	    "  -V, --version          print version and exit\n"
 	    "  -v, --verbose          verbose mode\n"
+	    "  -x, --exec COMMAND     pipe output to COMMAND and report throughput\n"
+	    "\n"
+	    "If OUTFILE is `-', write to standard output. OUTFILE is optional with check.\n"
 	    "\n"
-	    "If OUTFILE is `-', write to standard output.\n");
+	    "With jobs, data is generated in independent blocks, and differs from the\n"
+	    "data generated without, but not with the number of threads.\n"
+	    "\n"
+	    "Calibration sweeps the ratio for each combination of the exponents, which\n"
+	    "may be given as comma separated lists. Tables may be concatenated into one\n"
+	    "FILE, and only entries for the mode (bulk or precise) are used. The ratio\n"
+	    "for a target is interpolated between the entries whose achieved ratios\n"
+	    "bracket it, and then between the grid exponents around the given ones.\n"
+	    "\n"
+	    "types:\n"
+	    "  lz           LZ-compressible data with the ratio and exponents [default]\n");
+
+	for (i = 0; lzdg_model_type(i) != NULL; ++i) {
+		printf("  %-12s %s\n", lzdg_model_type(i), lzdg_model_description(i));
+	}
 }
 
 static void
@@ -178,30 +839,58 @@ main(int argc, char *argv[])
 	double ratio = 3.0;
 	double len_exp = 3.0;
 	double lit_exp = 3.0;
+	double len_exps[MAX_CALIBRATION_EXPS] = { 3.0 };
+	double lit_exps[MAX_CALIBRATION_EXPS] = { 3.0 };
+	double target_ratio = 0.0;
+	unsigned long long freq[256] = { 0 };
 	unsigned char *buffer = NULL;
 	const char *outfile = NULL;
+	const char *exec_cmd = NULL;
+	const char *calibration_file = NULL;
+	const char *type = NULL;
+	const char *params[MAX_PARAMS];
+	struct lzdg_model *model = NULL;
 	FILE *fp = NULL;
 	uint64_t seed;
 	size_t size = 1024 * 1024;
 	size_t offs = 0;
+	size_t num_buffers = 1;
+	size_t chunk_size = BLOCK_SIZE;
+	size_t num_params = 0;
+	int num_len_exps = 1;
+	int num_lit_exps = 1;
+	int jobs = 0;
 	int flag_bulk = 0;
+	int flag_calibrate = 0;
+	int flag_check = 0;
 	int flag_force = 0;
 	int flag_verbose = 0;
 	int retval = EXIT_FAILURE;
-	int c;
+	int c, i;
+#if defined(LZDG_HAVE_EXEC)
+	static struct exec_state ex;
+#endif
 
 	const struct parg_option long_options[] = {
 		{ "bulk", PARG_NOARG, NULL, 'b' },
+		{ "calibration", PARG_REQARG, NULL, 'C' },
+		{ "calibrate", PARG_NOARG, NULL, 'c' },
 		{ "force", PARG_NOARG, NULL, 'f' },
 		{ "help", PARG_NOARG, NULL, 'h' },
+		{ "check", PARG_NOARG, NULL, 'k' },
+		{ "jobs", PARG_REQARG, NULL, 'j' },
 		{ "literal-exp", PARG_REQARG, NULL, 'l' },
 		{ "match-exp", PARG_REQARG, NULL, 'm' },
 		{ "output", PARG_REQARG, NULL, 'o' },
+		{ "param", PARG_REQARG, NULL, 'p' },
+		{ "target-ratio", PARG_REQARG, NULL, 'R' },
 		{ "ratio", PARG_REQARG, NULL, 'r' },
 		{ "seed", PARG_REQARG, NULL, 'S' },
 		{ "size", PARG_REQARG, NULL, 's' },
+		{ "type", PARG_REQARG, NULL, 't' },
 		{ "version", PARG_NOARG, NULL, 'V' },
 		{ "verbose", PARG_NOARG, NULL, 'v' },
+		{ "exec", PARG_REQARG, NULL, 'x' },
 		{ 0, 0, 0, 0 }
 	};
 
@@ -209,7 +898,7 @@ main(int argc, char *argv[])
 
 	parg_init(&ps);
 
-	while ((c = parg_getopt_long(&ps, argc, argv, "bfhl:m:o:r:S:s:Vv", long_options, NULL)) != -1) {
+	while ((c = parg_getopt_long(&ps, argc, argv, "bC:cfhj:kl:m:o:p:R:r:S:s:t:Vvx:", long_options, NULL)) != -1) {
 		switch (c) {
 		case 1:
 		case 'o':
@@ -224,27 +913,76 @@ main(int argc, char *argv[])
 		case 'b':
 			flag_bulk = 1;
 			break;
+		case 'C':
+			calibration_file = ps.optarg;
+			break;
+		case 'c':
+			flag_calibrate = 1;
+			break;
 		case 'f':
 			flag_force = 1;
 			break;
-		case 'l':
+		case 'j':
 			{
 				char *ep = NULL;
-				double v;
+				long v;
 
 				errno = 0;
 
-				v = strtod(ps.optarg, &ep);
+				v = strtol(ps.optarg, &ep, 10);
 
-				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE) {
-					printf_error("literal exponent must be a floating point value");
+				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE || v < 1 || v > 1024) {
+					printf_error("jobs must be an integer between 1 and 1024");
 					return EXIT_FAILURE;
 				}
 
-				lit_exp = v;
+				jobs = (int) v;
 			}
 			break;
+		case 'k':
+			flag_check = 1;
+			break;
+		case 'l':
+			num_lit_exps = lzdg_parse_list(ps.optarg, lit_exps, MAX_CALIBRATION_EXPS);
+
+			for (i = 0; i < num_lit_exps; ++i) {
+				if (!lzdg_valid_exp(lit_exps[i])) {
+					num_lit_exps = -1;
+				}
+			}
+
+			if (num_lit_exps <= 0) {
+				printf_error("literal exponent must be a positive floating point value");
+				return EXIT_FAILURE;
+			}
+
+			lit_exp = lit_exps[0];
+			break;
 		case 'm':
+			num_len_exps = lzdg_parse_list(ps.optarg, len_exps, MAX_CALIBRATION_EXPS);
+
+			for (i = 0; i < num_len_exps; ++i) {
+				if (!lzdg_valid_exp(len_exps[i])) {
+					num_len_exps = -1;
+				}
+			}
+
+			if (num_len_exps <= 0) {
+				printf_error("match exponent must be a positive floating point value");
+				return EXIT_FAILURE;
+			}
+
+			len_exp = len_exps[0];
+			break;
+		case 'p':
+			if (num_params == MAX_PARAMS) {
+				printf_error("too many parameters");
+				return EXIT_FAILURE;
+			}
+
+			params[num_params++] = ps.optarg;
+			break;
+		case 'r':
 			{
 				char *ep = NULL;
 				double v;
@@ -253,15 +991,15 @@ main(int argc, char *argv[])
 
 				v = strtod(ps.optarg, &ep);
 
-				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE) {
-					printf_error("match exponent must be a floating point value");
+				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE || !lzdg_valid_ratio(v)) {
+					printf_error("ratio must be a finite floating point value >= 1.0");
 					return EXIT_FAILURE;
 				}
 
-				len_exp = v;
+				ratio = v;
 			}
 			break;
-		case 'r':
+		case 'R':
 			{
 				char *ep = NULL;
 				double v;
@@ -270,12 +1008,12 @@ main(int argc, char *argv[])
 
 				v = strtod(ps.optarg, &ep);
 
-				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE || v < 1.0) {
-					printf_error("ratio must be a floating point value >= 1.0");
+				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE || !lzdg_valid_ratio(v)) {
+					printf_error("target ratio must be a finite floating point value >= 1.0");
 					return EXIT_FAILURE;
 				}
 
-				ratio = v;
+				target_ratio = v;
 			}
 			break;
 		case 'S':
@@ -302,7 +1040,7 @@ main(int argc, char *argv[])
 
 				errno = 0;
 
-				n = strtosize(ps.optarg, &ep, 0);
+				n = lzdg_strtosize(ps.optarg, &ep, 0);
 
 				if (ep == ps.optarg || *ep != '\0' || errno == ERANGE || n == 0) {
 					printf_error("size must be a positive integer");
@@ -312,6 +1050,9 @@ main(int argc, char *argv[])
 				size = n;
 			}
 			break;
+		case 't':
+			type = ps.optarg;
+			break;
 		case 'h':
 			print_help();
 			return EXIT_SUCCESS;
@@ -323,6 +1064,14 @@ main(int argc, char *argv[])
 		case 'v':
 			flag_verbose++;
 			break;
+		case 'x':
+#if defined(LZDG_HAVE_EXEC)
+			exec_cmd = ps.optarg;
+#else
+			printf_error("exec is not supported on this platform");
+			return EXIT_FAILURE;
+#endif
+			break;
 		default:
 			printf_error("option error at `%s'", argv[ps.optind - 1]);
 			return EXIT_FAILURE;
@@ -330,12 +1079,93 @@ main(int argc, char *argv[])
 		}
 	}
 
-	if (outfile == NULL) {
+	if (type != NULL && strcmp(type, "lz") == 0) {
+		type = NULL;
+	}
+
+	if (type == NULL && num_params > 0) {
+		printf_error("parameters require a model type");
+		return EXIT_FAILURE;
+	}
+
+	if (type != NULL && (flag_check || flag_calibrate || target_ratio > 0.0)) {
+		printf_error("check, calibrate and target ratio require type lz");
+		return EXIT_FAILURE;
+	}
+
+	if (flag_calibrate && exec_cmd == NULL) {
+		printf_error("calibrate requires a command to exec");
+		return EXIT_FAILURE;
+	}
+
+	if ((num_lit_exps > 1 || num_len_exps > 1) && !flag_calibrate) {
+		printf_error("exponent lists require calibrate");
+		return EXIT_FAILURE;
+	}
+
+	if (jobs > 0 && exec_cmd != NULL) {
+		printf_error("jobs cannot be combined with exec");
+		return EXIT_FAILURE;
+	}
+
+	if (flag_check && exec_cmd != NULL) {
+		printf_error("check cannot be combined with exec");
+		return EXIT_FAILURE;
+	}
+
+	if (outfile == NULL && !flag_check && (exec_cmd == NULL || flag_calibrate)) {
 		printf_error("too few arguments");
 		return EXIT_FAILURE;
 	}
 
-	if (strcmp(outfile, "-") == 0) {
+	if (outfile != NULL && exec_cmd != NULL && !flag_calibrate) {
+		printf_error("OUTFILE cannot be combined with exec");
+		return EXIT_FAILURE;
+	}
+
+	if (target_ratio > 0.0) {
+		int res;
+
+		if (calibration_file == NULL) {
+			printf_error("target ratio requires a calibration file");
+			return EXIT_FAILURE;
+		}
+
+		res = calibrated_ratio(calibration_file, target_ratio, len_exp, lit_exp,
+		                       flag_bulk, &ratio);
+
+		if (res < 0) {
+			perror(EXE_NAME ": unable to read calibration file");
+			return EXIT_FAILURE;
+		}
+
+		if (res > 0 || ratio < 1.0) {
+			fprintf(stderr, EXE_NAME ": target ratio %.3f not in %s calibration for"
+			        " literal exponent %.3f, match exponent %.3f\n",
+			        target_ratio, flag_bulk ? "bulk" : "precise", lit_exp, len_exp);
+			return EXIT_FAILURE;
+		}
+
+		if (flag_verbose > 0) {
+			fprintf(stderr, EXE_NAME ": using ratio %.3f\n", ratio);
+		}
+	}
+
+	if (exec_cmd != NULL) {
+		/* Alternate between two buffers, see exec_write */
+		num_buffers = 2;
+	}
+
+	if (jobs > 0) {
+		/* Generate a block for each thread at a time */
+		chunk_size = (size_t) jobs * BLOCK_SIZE;
+		num_buffers = jobs;
+	}
+
+	if (outfile == NULL) {
+		fp = NULL;
+	}
+	else if (strcmp(outfile, "-") == 0) {
 #if defined(_WIN32) || defined(__CYGWIN__)
 		if (setmode(fileno(stdout), O_BINARY) == -1) {
 			perror(EXE_NAME ": unable to set binary mode");
@@ -371,30 +1201,79 @@ main(int argc, char *argv[])
 		}
 	}
 
-	pcg32_srandom(seed, 0xC0FFEE);
+	lzdg_seed(seed);
 
 	if (flag_verbose > 0) {
-		fprintf(stderr, EXE_NAME ": seed 0x%016" PRIX64 "\n", seed);
+		fprintf(stderr, EXE_NAME ": seed 0x%016" PRIX64 " (%s)\n", seed, lzdg_rng_name());
+	}
+
+	if (type != NULL) {
+		const char *error = NULL;
+
+		model = lzdg_model_create(type, params, num_params, seed, &error);
+
+		if (model == NULL) {
+			fprintf(stderr, EXE_NAME ": %s\n", error);
+			goto out;
+		}
 	}
 
-	buffer = malloc(BLOCK_SIZE);
+	buffer = malloc(num_buffers * BLOCK_SIZE);
 
 	if (buffer == NULL) {
 		perror(EXE_NAME ": unable to allocate buffer");
 		goto out;
 	}
 
+#if defined(LZDG_HAVE_EXEC)
+	if (exec_cmd != NULL) {
+		if (flag_calibrate) {
+			if (calibrate(&ex, exec_cmd, fp, buffer, seed, size,
+			              len_exps, num_len_exps, lit_exps, num_lit_exps,
+			              flag_bulk) != 0) {
+				goto out;
+			}
+		}
+		else {
+			double start_time = get_time();
+
+			if (exec_generate(&ex, exec_cmd, buffer, size,
+			                  ratio, len_exp, lit_exp, flag_bulk, model) != 0) {
+				goto out;
+			}
+
+			exec_report(&ex, size, get_time() - start_time);
+		}
+
+		retval = EXIT_SUCCESS;
+		goto out;
+	}
+#endif
+
 	while (offs < size) {
-		size_t num = size - offs > BLOCK_SIZE ? BLOCK_SIZE : size - offs;
+		size_t num = size - offs > chunk_size ? chunk_size : size - offs;
 
-		if (flag_bulk) {
+		if (jobs > 0 || model != NULL) {
+			generate_blocks(buffer, num, ratio, len_exp, lit_exp, seed,
+			                offs / BLOCK_SIZE, flag_bulk ? LZDG_FLAG_BULK : 0,
+			                model, jobs > 0 ? jobs : 1);
+		}
+		else if (flag_bulk) {
 			lzdg_generate_data_bulk(buffer, num, ratio, len_exp, lit_exp);
 		}
 		else {
 			lzdg_generate_data(buffer, num, ratio, len_exp, lit_exp);
 		}
 
-		if (fwrite(buffer, 1, num, fp) != num) {
+		if (flag_check) {
+			size_t i;
+
+			for (i = 0; i < num; ++i) {
+				freq[buffer[i]]++;
+			}
+		}
+
+		if (fp != NULL && fwrite(buffer, 1, num, fp) != num) {
 			perror(EXE_NAME ": write error");
 			goto out;
 		}
@@ -402,6 +1281,10 @@ main(int argc, char *argv[])
 		offs += num;
 	}
 
+	if (flag_check && check_distribution(freq, lit_exp) != 0) {
+		goto out;
+	}
+
 	retval = EXIT_SUCCESS;
 
 out:
@@ -412,5 +1295,7 @@ out:
 	free(buffer);
 	buffer = NULL;
 
+	lzdg_model_destroy(model);
+
 	return retval;
 }